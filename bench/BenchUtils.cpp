@@ -0,0 +1,271 @@
+/*
+ * Copyright 2023 Clement Vuchener
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "BenchUtils.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+
+#ifdef __linux__
+#include <dlfcn.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#endif
+
+static std::atomic<std::uint64_t> allocations = 0;
+static std::atomic<std::int64_t> heap_bytes = 0;
+static std::atomic<std::int64_t> heap_peak_bytes = 0;
+static thread_local bool counted_thread = true;
+
+static inline void count_allocation()
+{
+	if (counted_thread)
+		allocations.fetch_add(1, std::memory_order_relaxed);
+}
+
+#ifdef __GLIBC__
+#include <malloc.h>
+
+static inline void add_heap_bytes(std::int64_t bytes)
+{
+	if (!counted_thread)
+		return;
+	auto current = heap_bytes.fetch_add(bytes, std::memory_order_relaxed) + bytes;
+	auto peak = heap_peak_bytes.load(std::memory_order_relaxed);
+	while (current > peak && !heap_peak_bytes.compare_exchange_weak(peak, current,
+			std::memory_order_relaxed))
+		;
+}
+
+static inline void *allocated(void *ptr)
+{
+	count_allocation();
+	if (ptr)
+		add_heap_bytes(malloc_usable_size(ptr));
+	return ptr;
+}
+
+// Interpose malloc so that allocations from Qt (which uses malloc directly
+// for its containers) and protobuf are both counted.
+extern "C" {
+void *__libc_malloc(std::size_t size);
+void *__libc_calloc(std::size_t n, std::size_t size);
+void *__libc_realloc(void *ptr, std::size_t size);
+void *__libc_memalign(std::size_t alignment, std::size_t size);
+void __libc_free(void *ptr);
+
+void *malloc(std::size_t size) noexcept
+{
+	return allocated(__libc_malloc(size));
+}
+
+void *calloc(std::size_t n, std::size_t size) noexcept
+{
+	return allocated(__libc_calloc(n, size));
+}
+
+void *realloc(void *ptr, std::size_t size) noexcept
+{
+	if (ptr)
+		add_heap_bytes(-std::int64_t(malloc_usable_size(ptr)));
+	return allocated(__libc_realloc(ptr, size));
+}
+
+void *memalign(std::size_t alignment, std::size_t size) noexcept
+{
+	return allocated(__libc_memalign(alignment, size));
+}
+
+void *aligned_alloc(std::size_t alignment, std::size_t size) noexcept
+{
+	return allocated(__libc_memalign(alignment, size));
+}
+
+int posix_memalign(void **ptr, std::size_t alignment, std::size_t size) noexcept
+{
+	*ptr = allocated(__libc_memalign(alignment, size));
+	return *ptr ? 0 : ENOMEM;
+}
+
+void free(void *ptr) noexcept
+{
+	if (ptr)
+		add_heap_bytes(-std::int64_t(malloc_usable_size(ptr)));
+	__libc_free(ptr);
+}
+}
+#else
+// Only C++ allocations can be counted portably
+void *operator new(std::size_t size)
+{
+	count_allocation();
+	if (auto ptr = std::malloc(size ? size : 1))
+		return ptr;
+	throw std::bad_alloc();
+}
+
+void operator delete(void *ptr) noexcept
+{
+	std::free(ptr);
+}
+
+void operator delete(void *ptr, std::size_t) noexcept
+{
+	std::free(ptr);
+}
+#endif
+
+static std::atomic<std::uint64_t> socket_writes = 0;
+
+#ifdef __linux__
+// Interpose the system calls Qt may use for writing to sockets
+static void count_socket_write(int fd)
+{
+	struct stat st;
+	if (counted_thread && fstat(fd, &st) == 0 && S_ISSOCK(st.st_mode))
+		socket_writes.fetch_add(1, std::memory_order_relaxed);
+}
+
+template <typename F>
+static F *next_symbol(const char *name)
+{
+	return reinterpret_cast<F *>(dlsym(RTLD_NEXT, name));
+}
+
+extern "C" {
+ssize_t write(int fd, const void *buf, std::size_t n)
+{
+	static auto next = next_symbol<ssize_t(int, const void *, std::size_t)>("write");
+	count_socket_write(fd);
+	return next(fd, buf, n);
+}
+
+ssize_t writev(int fd, const struct iovec *iov, int iovcnt)
+{
+	static auto next = next_symbol<ssize_t(int, const struct iovec *, int)>("writev");
+	count_socket_write(fd);
+	return next(fd, iov, iovcnt);
+}
+
+ssize_t send(int fd, const void *buf, std::size_t n, int flags)
+{
+	static auto next = next_symbol<ssize_t(int, const void *, std::size_t, int)>("send");
+	count_socket_write(fd);
+	return next(fd, buf, n, flags);
+}
+
+ssize_t sendto(int fd, const void *buf, std::size_t n, int flags,
+	       const struct sockaddr *addr, socklen_t addr_len)
+{
+	static auto next = next_symbol<ssize_t(int, const void *, std::size_t, int,
+			const struct sockaddr *, socklen_t)>("sendto");
+	count_socket_write(fd);
+	return next(fd, buf, n, flags, addr, addr_len);
+}
+
+ssize_t sendmsg(int fd, const struct msghdr *msg, int flags)
+{
+	static auto next = next_symbol<ssize_t(int, const struct msghdr *, int)>("sendmsg");
+	count_socket_write(fd);
+	return next(fd, msg, flags);
+}
+}
+#endif
+
+std::uint64_t bench::allocation_count()
+{
+	return allocations.load(std::memory_order_relaxed);
+}
+
+std::int64_t bench::heap_in_use()
+{
+	return heap_bytes.load(std::memory_order_relaxed);
+}
+
+std::int64_t bench::heap_peak()
+{
+	return heap_peak_bytes.load(std::memory_order_relaxed);
+}
+
+void bench::reset_heap_peak()
+{
+	heap_peak_bytes.store(heap_bytes.load(std::memory_order_relaxed), std::memory_order_relaxed);
+}
+
+std::uint64_t bench::socket_write_count()
+{
+	return socket_writes.load(std::memory_order_relaxed);
+}
+
+void bench::count_allocations(bool enabled)
+{
+	counted_thread = enabled;
+}
+
+double bench::Result::callsPerSecond() const
+{
+	return samples.size() / std::chrono::duration<double>(total).count();
+}
+
+std::chrono::nanoseconds bench::Result::percentile(double p)
+{
+	if (samples.empty())
+		return {};
+	std::size_t n = std::min(samples.size() - 1, std::size_t(p * samples.size()));
+	std::ranges::nth_element(samples, samples.begin() + n);
+	return samples[n];
+}
+
+double bench::Result::allocationsPerCall() const
+{
+	return samples.empty() ? 0.0 : double(allocations) / samples.size();
+}
+
+double bench::Result::socketWritesPerCall() const
+{
+	return samples.empty() ? 0.0 : double(socket_writes) / samples.size();
+}
+
+void bench::report(const std::string &name, const std::string &params, Result &result)
+{
+	using us = std::chrono::duration<double, std::micro>;
+	std::printf("%-24s %-36s %10.0f calls/s  p50 %9.1f us  p99 %9.1f us  %7.1f allocs/call  %5.2f writes/call  peak heap %8.1f KiB\n",
+		name.c_str(), params.c_str(),
+		result.callsPerSecond(),
+		us(result.percentile(0.5)).count(),
+		us(result.percentile(0.99)).count(),
+		result.allocationsPerCall(),
+		result.socketWritesPerCall(),
+		result.heap_peak / 1024.0);
+	std::fflush(stdout);
+}
+
+int bench::iterations_from_args(int argc, char *argv[], int default_iterations)
+{
+	if (argc > 1) {
+		if (int n = std::atoi(argv[1]); n > 0)
+			return n;
+	}
+	return default_iterations;
+}
@@ -0,0 +1,148 @@
+/*
+ * Copyright 2023 Clement Vuchener
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef DFHACK_CLIENT_QT_BENCH_UTILS_H
+#define DFHACK_CLIENT_QT_BENCH_UTILS_H
+
+#include <QFuture>
+#include <QThread>
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <dfhack-client-qt/Client.h>
+
+namespace bench
+{
+
+/**
+ * Number of heap allocations made so far by counted threads.
+ */
+std::uint64_t allocation_count();
+
+/**
+ * Heap bytes currently allocated by counted threads (only available with
+ * glibc).
+ */
+std::int64_t heap_in_use();
+/**
+ * Highest value of \ref heap_in_use since the last \ref reset_heap_peak.
+ */
+std::int64_t heap_peak();
+void reset_heap_peak();
+
+/**
+ * Number of write system calls on sockets made so far by counted threads
+ * (only available on Linux).
+ */
+std::uint64_t socket_write_count();
+
+/**
+ * Enable or disable allocation and socket write counting for the current
+ * thread (enabled by default). Used for excluding the mock server thread from
+ * measures.
+ */
+void count_allocations(bool enabled);
+
+/**
+ * Client running in its own thread, same as in test-sync.
+ */
+struct ClientThread
+{
+	DFHack::Client client;
+	QThread thread;
+
+	ClientThread() {
+		client.moveToThread(&thread);
+		thread.start();
+	}
+
+	~ClientThread() {
+		thread.quit();
+		thread.wait();
+	}
+};
+
+template <typename T>
+T sync(QFuture<T> &&future)
+{
+	future.waitForFinished();
+	return future.result();
+}
+
+struct Result
+{
+	std::vector<std::chrono::nanoseconds> samples;
+	std::chrono::nanoseconds total;
+	std::uint64_t allocations;
+	std::uint64_t socket_writes;
+	std::int64_t heap_peak; // above the heap in use when starting
+
+	double callsPerSecond() const;
+	/**
+	 * Sample at percentile \p p (in [0, 1]). Sorts samples.
+	 */
+	std::chrono::nanoseconds percentile(double p);
+	double allocationsPerCall() const;
+	double socketWritesPerCall() const;
+};
+
+/**
+ * Print a result line for benchmark \p name with parameters \p params.
+ */
+void report(const std::string &name, const std::string &params, Result &result);
+
+/**
+ * Run \p f \p iterations times (after a short warm-up) and measure latency
+ * of each run, total allocations, socket writes and peak heap usage.
+ */
+template <typename F>
+Result measure(int iterations, F &&f)
+{
+	using clock = std::chrono::steady_clock;
+	for (int i = 0; i < iterations / 10; ++i)
+		f();
+	Result result;
+	result.samples.reserve(iterations);
+	auto allocations = allocation_count();
+	auto socket_writes = socket_write_count();
+	auto heap = heap_in_use();
+	reset_heap_peak();
+	auto start = clock::now();
+	for (int i = 0; i < iterations; ++i) {
+		auto t0 = clock::now();
+		f();
+		result.samples.push_back(clock::now() - t0);
+	}
+	result.total = clock::now() - start;
+	result.allocations = allocation_count() - allocations;
+	result.socket_writes = socket_write_count() - socket_writes;
+	result.heap_peak = heap_peak() - heap;
+	return result;
+}
+
+/**
+ * Parse iteration count from the first command line argument.
+ */
+int iterations_from_args(int argc, char *argv[], int default_iterations);
+
+} // namespace bench
+
+#endif
@@ -0,0 +1,211 @@
+/*
+ * Copyright 2023 Clement Vuchener
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "MockData.h"
+
+#include <algorithm>
+#include <string>
+
+static constexpr int MapSize = 192;
+static constexpr int LaborCount = 94;
+static constexpr int SkillCount = 12;
+
+static void make_unit(dfproto::BasicUnitInfo &unit, const dfproto::BasicUnitInfoMask &mask, int index, int tick)
+{
+	bool moving = index % 5 == tick % 5;
+	int step = moving ? tick : tick - tick % 5;
+	unit.set_unit_id(bench::FirstUnitId + index);
+	unit.set_pos_x((index * 7 + step) % MapSize);
+	unit.set_pos_y((index * 13 + step / 2) % MapSize);
+	unit.set_pos_z(100 + index % 20);
+	auto name = unit.mutable_name();
+	name->set_first_name("Urist" + std::to_string(index));
+	name->set_last_name("McMock");
+	unit.set_flags1(0x00000100u | (index % 3 == 0 ? 0x00000002u : 0u) | (moving ? 0x00010000u : 0u));
+	unit.set_flags2(0x00800000u | ((index + tick / 10) % 7 == 0 ? 0x00000080u : 0u));
+	unit.set_flags3(index % 11 == 0 ? 0x00000001u : 0u);
+	unit.set_race(index % 10 == 0 ? 1 : 0);
+	unit.set_caste(index % 2);
+	unit.set_gender(index % 2);
+	unit.set_civ_id(index % 10 == 0 ? -1 : 1);
+	if (index % 8 == 0) {
+		unit.set_squad_id(index / 80);
+		unit.set_squad_position(index / 8 % 10);
+	}
+	if (mask.profession()) {
+		unit.set_profession(index % 100);
+		if (index % 17 == 0)
+			unit.set_custom_profession("Mock " + std::to_string(index));
+	}
+	if (mask.labors()) {
+		for (int labor = 0; labor < LaborCount; ++labor)
+			if ((index + labor + tick / 10) % 9 == 0)
+				unit.add_labors(labor);
+	}
+	if (mask.skills()) {
+		for (int skill = 0; skill < SkillCount; ++skill) {
+			auto info = unit.add_skills();
+			info->set_id((index + skill * 11) % 116);
+			info->set_level(skill % 16);
+			info->set_experience((index * skill + tick) % 1000);
+		}
+	}
+	if (mask.misc_traits()) {
+		auto trait = unit.add_misc_traits();
+		trait->set_id(index % 30);
+		trait->set_value(tick % 100);
+	}
+}
+
+void bench::make_units(dfproto::ListUnitsOut &out, const dfproto::ListUnitsIn &in, int count, int tick)
+{
+	if (in.id_list_size() > 0) {
+		for (int id: in.id_list()) {
+			int index = id - FirstUnitId;
+			if (index >= 0 && index < count)
+				make_unit(*out.add_value(), in.mask(), index, tick);
+		}
+	}
+	else {
+		out.mutable_value()->Reserve(count);
+		for (int index = 0; index < count; ++index)
+			make_unit(*out.add_value(), in.mask(), index, tick);
+	}
+}
+
+static constexpr int CreatureBaseType = 19;
+static constexpr int PlantBaseType = 419;
+
+static bool make_material(dfproto::BasicMaterialInfo &material, const dfproto::BasicMaterialInfoMask &mask, int type, int index)
+{
+	std::string token;
+	if (type == 0 && index >= 0 && index < bench::InorganicCount)
+		token = "INORGANIC:MOCK_STONE_" + std::to_string(index);
+	else if (type >= 0 && type < bench::BuiltinMaterialCount && index == -1)
+		token = "BUILTIN_" + std::to_string(type);
+	else if (type >= CreatureBaseType && type < CreatureBaseType + bench::CreatureMaterialCount
+			&& index >= 0 && index < bench::CreatureCount)
+		token = "CREATURE:MOCK_" + std::to_string(index) + ":MAT_" + std::to_string(type - CreatureBaseType);
+	else if (type >= PlantBaseType && type < PlantBaseType + bench::PlantMaterialCount
+			&& index >= 0 && index < bench::PlantCount)
+		token = "PLANT:MOCK_" + std::to_string(index) + ":MAT_" + std::to_string(type - PlantBaseType);
+	else
+		return false;
+	material.set_type(type);
+	material.set_index(index);
+	material.set_token(token);
+	if (type >= CreatureBaseType && type < PlantBaseType)
+		material.set_creature_id(index);
+	else if (type >= PlantBaseType)
+		material.set_plant_id(index);
+	int state_count = std::max(mask.states_size(), 1);
+	for (int i = 0; i < state_count; ++i) {
+		material.add_state_color(0xff000000u | std::uint32_t(index * 2654435761u) >> 8);
+		material.add_state_name("mock " + token);
+		material.add_state_adj("mock");
+	}
+	if (mask.flags()) {
+		for (int flag = 0; flag < 64; ++flag)
+			if ((index + flag) % 13 == 0)
+				material.add_flags(flag);
+		if (type == 0)
+			material.add_inorganic_flags(index % 40);
+	}
+	if (mask.reaction()) {
+		material.add_reaction_class("MOCK_CLASS");
+		auto product = material.add_reaction_product();
+		product->set_id("MOCK_PRODUCT");
+		product->set_type(type);
+		product->set_index(index);
+	}
+	return true;
+}
+
+void bench::make_materials(dfproto::ListMaterialsOut &out, const dfproto::ListMaterialsIn &in)
+{
+	const auto &mask = in.mask();
+	for (const auto &id: in.id_list()) {
+		auto material = out.add_value();
+		if (!make_material(*material, mask, id.type(), id.index()))
+			out.mutable_value()->RemoveLast();
+	}
+	if (in.builtin())
+		for (int type = 0; type < BuiltinMaterialCount; ++type)
+			make_material(*out.add_value(), mask, type, -1);
+	if (in.inorganic())
+		for (int index = 0; index < InorganicCount; ++index)
+			make_material(*out.add_value(), mask, 0, index);
+	if (in.creatures())
+		for (int index = 0; index < CreatureCount; ++index)
+			for (int m = 0; m < CreatureMaterialCount; ++m)
+				make_material(*out.add_value(), mask, CreatureBaseType + m, index);
+	if (in.plants())
+		for (int index = 0; index < PlantCount; ++index)
+			for (int m = 0; m < PlantMaterialCount; ++m)
+				make_material(*out.add_value(), mask, PlantBaseType + m, index);
+}
+
+static void make_enum(google::protobuf::RepeatedPtrField<dfproto::EnumItemName> &items,
+		const std::string &prefix, int count, bool bitfield = false)
+{
+	for (int value = 0; value < count; ++value) {
+		auto item = items.Add();
+		item->set_value(value);
+		item->set_name(prefix + std::to_string(value));
+		if (bitfield)
+			item->set_bit_size(1);
+	}
+}
+
+void bench::make_enums(dfproto::ListEnumsOut &out)
+{
+	make_enum(*out.mutable_material_flags(), "MATERIAL_FLAG_", 64);
+	make_enum(*out.mutable_inorganic_flags(), "INORGANIC_FLAG_", 40);
+	make_enum(*out.mutable_unit_flags1(), "unit_flag1_", 32, true);
+	make_enum(*out.mutable_unit_flags2(), "unit_flag2_", 32, true);
+	make_enum(*out.mutable_unit_flags3(), "unit_flag3_", 32, true);
+	make_enum(*out.mutable_unit_labor(), "LABOR_", LaborCount);
+	make_enum(*out.mutable_job_skill(), "SKILL_", 116);
+	make_enum(*out.mutable_cie_add_tag_mask1(), "cie1_", 32, true);
+	make_enum(*out.mutable_cie_add_tag_mask2(), "cie2_", 32, true);
+	make_enum(*out.mutable_death_info_flags(), "death_", 32, true);
+	make_enum(*out.mutable_profession(), "PROFESSION_", 100);
+}
+
+void bench::make_job_skills(dfproto::ListJobSkillsOut &out)
+{
+	for (int id = 0; id < 116; ++id) {
+		auto skill = out.add_skill();
+		skill->set_id(id);
+		skill->set_key("SKILL_" + std::to_string(id));
+		skill->set_caption("Skill " + std::to_string(id));
+		skill->set_labor(id % LaborCount);
+	}
+	for (int id = 0; id < 100; ++id) {
+		auto profession = out.add_profession();
+		profession->set_id(id);
+		profession->set_key("PROFESSION_" + std::to_string(id));
+		profession->set_caption("Profession " + std::to_string(id));
+	}
+	for (int id = 0; id < LaborCount; ++id) {
+		auto labor = out.add_labor();
+		labor->set_id(id);
+		labor->set_key("LABOR_" + std::to_string(id));
+		labor->set_caption("Labor " + std::to_string(id));
+	}
+}
@@ -0,0 +1,73 @@
+/*
+ * Copyright 2023 Clement Vuchener
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef DFHACK_CLIENT_QT_BENCH_MOCK_DATA_H
+#define DFHACK_CLIENT_QT_BENCH_MOCK_DATA_H
+
+#include <dfhack-client-qt/BasicApi.pb.h>
+
+namespace bench
+{
+
+/**
+ * Id of the first unit created by \ref make_units.
+ */
+static constexpr int FirstUnitId = 1000;
+
+/**
+ * Fill \p out with \p count deterministic units, honouring the mask and the
+ * id list from \p in.
+ *
+ * \p tick simulates time passing: about one unit in five moves at each tick
+ * and some flags and labors change.
+ */
+void make_units(dfproto::ListUnitsOut &out, const dfproto::ListUnitsIn &in, int count, int tick = 0);
+
+/**
+ * Material counts of the mock catalogue from \ref make_materials.
+ */
+static constexpr int BuiltinMaterialCount = 19;
+static constexpr int InorganicCount = 2000;
+static constexpr int CreatureCount = 800;
+static constexpr int CreatureMaterialCount = 10; // per creature
+static constexpr int PlantCount = 500;
+static constexpr int PlantMaterialCount = 4; // per plant
+
+/**
+ * Fill \p out with deterministic materials, honouring the mask, the id list
+ * and the type selection from \p in.
+ *
+ * Types and indices follow DF conventions: builtin materials have types
+ * below 19 and index -1, inorganic materials type 0, creature materials
+ * types from 19 and plant materials types from 419.
+ */
+void make_materials(dfproto::ListMaterialsOut &out, const dfproto::ListMaterialsIn &in);
+
+/**
+ * Fill \p out with mock enum names, unit flag enums are bitfields with all
+ * 32 bits named.
+ */
+void make_enums(dfproto::ListEnumsOut &out);
+/**
+ * Fill \p out with mock skills, professions and labors.
+ */
+void make_job_skills(dfproto::ListJobSkillsOut &out);
+
+} // namespace bench
+
+#endif
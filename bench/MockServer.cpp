@@ -0,0 +1,357 @@
+/*
+ * Copyright 2023 Clement Vuchener
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "MockServer.h"
+
+#include <QTcpSocket>
+#include <QTimer>
+
+#include <algorithm>
+#include <cstring>
+#include <deque>
+
+#include <QtDebug>
+
+#include <dfhack-client-qt/Protocol.h>
+#include <dfhack-client-qt/CoreProtocol.pb.h>
+
+using namespace DFHack;
+using clock_type = std::chrono::steady_clock;
+
+// Ids 0 and 1 are BindMethod and RunCommand
+static constexpr int FirstBoundId = 2;
+
+struct MockServer::Connection
+{
+	QTcpSocket *socket;
+	bool handshake_done = false;
+	QByteArray buffer;
+	std::vector<std::size_t> bound; // method indices, offset by FirstBoundId
+	std::deque<std::pair<clock_type::time_point, QByteArray>> pending;
+	clock_type::time_point busy_until;
+	QTimer timer;
+
+	Connection(QTcpSocket *socket)
+		: socket(socket)
+	{
+		timer.setSingleShot(true);
+		timer.setTimerType(Qt::PreciseTimer);
+	}
+
+	~Connection()
+	{
+		socket->disconnect();
+		socket->abort();
+		socket->deleteLater();
+	}
+};
+
+static void append_frame(QByteArray &data, int16_t id, const std::string &payload)
+{
+	MessageHeader hdr = {};
+	hdr.id = id;
+	hdr.size = static_cast<int32_t>(payload.size());
+	data.append(reinterpret_cast<const char *>(&hdr), sizeof(hdr));
+	data.append(payload.data(), payload.size());
+}
+
+static void append_fail(QByteArray &data, CommandResult cr)
+{
+	MessageHeader hdr = {};
+	hdr.id = MessageHeader::ReplyFail;
+	hdr.size = static_cast<int32_t>(cr);
+	data.append(reinterpret_cast<const char *>(&hdr), sizeof(hdr));
+}
+
+static void append_error_text(QByteArray &data, const std::string &text)
+{
+	dfproto::CoreTextNotification notification;
+	auto fragment = notification.add_fragments();
+	fragment->set_text(text);
+	fragment->set_color(dfproto::CoreTextFragment::COLOR_LIGHTRED);
+	append_frame(data, MessageHeader::ReplyText, notification.SerializeAsString());
+}
+
+MockServer::MockServer(QObject *parent)
+	: QObject(parent)
+	, server(this)
+{
+	QObject::connect(&server, &QTcpServer::newConnection,
+		this, &MockServer::newConnection);
+
+	addMethod<dfproto::EmptyMessage, dfproto::StringMessage>("", "GetVersion",
+		[this](const dfproto::EmptyMessage &, dfproto::StringMessage &out) {
+			out.set_value(options().version);
+			return CommandResult::Ok;
+		});
+	addMethod<dfproto::EmptyMessage, dfproto::StringMessage>("", "GetDFVersion",
+		[this](const dfproto::EmptyMessage &, dfproto::StringMessage &out) {
+			out.set_value(options().df_version);
+			return CommandResult::Ok;
+		});
+	addMethod<dfproto::EmptyMessage, dfproto::StringMessage>("", "MockPayload",
+		[this](const dfproto::EmptyMessage &, dfproto::StringMessage &out) {
+			out.set_value(std::string(options().reply_size, 'x'));
+			return CommandResult::Ok;
+		});
+}
+
+MockServer::~MockServer()
+{
+}
+
+quint16 MockServer::listen()
+{
+	if (!server.listen(QHostAddress::LocalHost)) {
+		qCritical() << "Mock server failed to listen:" << server.errorString();
+		return 0;
+	}
+	return server.serverPort();
+}
+
+void MockServer::close()
+{
+	server.close();
+	connections.clear();
+}
+
+void MockServer::setOptions(const Options &options)
+{
+	QMutexLocker lock(&options_mutex);
+	opts = options;
+}
+
+MockServer::Options MockServer::options() const
+{
+	QMutexLocker lock(&options_mutex);
+	return opts;
+}
+
+void MockServer::addMethod(const std::string &plugin, const std::string &method,
+			   const std::string &input_msg, const std::string &output_msg,
+			   Handler handler)
+{
+	methods.push_back({plugin, method, input_msg, output_msg, std::move(handler)});
+}
+
+quint64 MockServer::callCount() const
+{
+	return call_count;
+}
+
+void MockServer::newConnection()
+{
+	while (auto socket = server.nextPendingConnection()) {
+		auto [it, inserted] = connections.emplace(socket, std::make_unique<Connection>(socket));
+		auto connection = it->second.get();
+		for (std::size_t i = 0; i < methods.size(); ++i)
+			if (methods[i].plugin.empty())
+				connection->bound.push_back(i);
+		QObject::connect(socket, &QIODevice::readyRead, this, [this, connection]() {
+			readyRead(connection);
+		});
+		// Queued so that the connection is not destroyed while being used
+		QObject::connect(socket, &QAbstractSocket::disconnected, this, [this, socket]() {
+			connections.erase(socket);
+		}, Qt::QueuedConnection);
+		QObject::connect(&connection->timer, &QTimer::timeout, this, [this, connection]() {
+			sendPending(connection);
+		});
+	}
+}
+
+void MockServer::readyRead(Connection *connection)
+{
+	auto &buffer = connection->buffer;
+	buffer.append(connection->socket->readAll());
+	qsizetype pos = 0;
+	while (true) {
+		auto available = buffer.size() - pos;
+		if (!connection->handshake_done) {
+			HandshakePacket packet;
+			if (available < qsizetype(sizeof(packet)))
+				break;
+			std::memcpy(&packet, buffer.constData() + pos, sizeof(packet));
+			pos += sizeof(packet);
+			if (!std::ranges::equal(packet.magic, HandshakePacket::RequestMagic)) {
+				qCritical() << "Mock server: invalid handshake";
+				connection->socket->abort();
+				return;
+			}
+			HandshakePacket reply = {};
+			std::ranges::copy(HandshakePacket::ReplyMagic, reply.magic);
+			reply.version = 1;
+			connection->socket->write(reinterpret_cast<const char *>(&reply), sizeof(reply));
+			connection->handshake_done = true;
+		}
+		else {
+			MessageHeader hdr;
+			if (available < qsizetype(sizeof(hdr)))
+				break;
+			std::memcpy(&hdr, buffer.constData() + pos, sizeof(hdr));
+			if (hdr.id == MessageHeader::RequestQuit) {
+				connection->socket->disconnectFromHost();
+				return;
+			}
+			if (hdr.size < 0 || hdr.size > MessageHeader::MaxMessageSize) {
+				qCritical() << "Mock server: invalid message size" << hdr.size;
+				connection->socket->abort();
+				return;
+			}
+			if (available < qsizetype(sizeof(hdr)) + hdr.size)
+				break;
+			std::string in(buffer.constData() + pos + sizeof(hdr), hdr.size);
+			pos += sizeof(hdr) + hdr.size;
+			handleCall(connection, hdr.id, in);
+		}
+	}
+	buffer.remove(0, pos);
+}
+
+void MockServer::handleCall(Connection *connection, int16_t id, const std::string &in)
+{
+	++call_count;
+	auto options = this->options();
+
+	QByteArray data;
+	if (options.notification_frames > 0) {
+		dfproto::CoreTextNotification notification;
+		for (int i = 0; i < options.fragments_per_frame; ++i) {
+			auto fragment = notification.add_fragments();
+			fragment->set_text(std::string(options.fragment_size, 'n'));
+			fragment->set_color(static_cast<dfproto::CoreTextFragment::Color>(i % 16));
+		}
+		auto text = notification.SerializeAsString();
+		for (int i = 0; i < options.notification_frames; ++i)
+			append_frame(data, MessageHeader::ReplyText, text);
+	}
+
+	std::string out;
+	CommandResult cr = CommandResult::Ok;
+	switch (id) {
+	case 0: { // BindMethod
+		dfproto::CoreBindRequest request;
+		if (!request.ParseFromString(in)) {
+			cr = CommandResult::LinkFailure;
+			break;
+		}
+		auto method = std::ranges::find_if(methods, [&](const Method &m) {
+			return m.plugin == request.plugin() && m.method == request.method();
+		});
+		if (method == methods.end()) {
+			append_error_text(data, "RPC method not found: " + request.plugin()
+					+ "::" + request.method() + "\n");
+			cr = CommandResult::Failure;
+			break;
+		}
+		if (method->input_msg != request.input_msg() || method->output_msg != request.output_msg()) {
+			append_error_text(data, "Requested wrong signature for RPC method: "
+					+ request.plugin() + "::" + request.method() + "\n");
+			cr = CommandResult::Failure;
+			break;
+		}
+		std::size_t index = std::distance(methods.begin(), method);
+		auto bound = std::ranges::find(connection->bound, index);
+		if (bound == connection->bound.end()) {
+			// Add all the methods from the same plugin (or core
+			// methods added after the connection was opened)
+			auto &ids = connection->bound;
+			for (std::size_t i = 0; i < methods.size(); ++i)
+				if (methods[i].plugin == method->plugin && std::ranges::find(ids, i) == ids.end())
+					ids.push_back(i);
+			bound = std::ranges::find(ids, index);
+		}
+		dfproto::CoreBindReply reply;
+		reply.set_assigned_id(FirstBoundId + std::distance(connection->bound.begin(), bound));
+		reply.SerializeToString(&out);
+		break;
+	}
+	case 1: { // RunCommand
+		dfproto::CoreRunCommandRequest request;
+		if (!request.ParseFromString(in))
+			cr = CommandResult::LinkFailure;
+		else
+			dfproto::EmptyMessage().SerializeToString(&out);
+		break;
+	}
+	default: {
+		std::size_t index = id - FirstBoundId;
+		if (id < FirstBoundId || index >= connection->bound.size()) {
+			append_error_text(data, "RPC call of invalid id " + std::to_string(id) + "\n");
+			cr = CommandResult::Failure;
+			break;
+		}
+		cr = methods[connection->bound[index]].handler(in, out);
+		break;
+	}
+	}
+
+	if (cr == CommandResult::Ok)
+		append_frame(data, MessageHeader::ReplyResult, out);
+	else
+		append_fail(data, cr);
+	sendReply(connection, std::move(data));
+}
+
+void MockServer::sendReply(Connection *connection, QByteArray &&data)
+{
+	auto options = this->options();
+	if (options.latency.count() == 0 && options.processing_time.count() == 0
+			&& connection->pending.empty()) {
+		connection->socket->write(data);
+		return;
+	}
+	auto handled = std::max(clock_type::now(), connection->busy_until) + options.processing_time;
+	connection->busy_until = handled;
+	connection->pending.emplace_back(handled + options.latency, std::move(data));
+	if (!connection->timer.isActive())
+		sendPending(connection);
+}
+
+void MockServer::sendPending(Connection *connection)
+{
+	auto now = clock_type::now();
+	auto &pending = connection->pending;
+	while (!pending.empty() && pending.front().first <= now) {
+		connection->socket->write(pending.front().second);
+		pending.pop_front();
+	}
+	if (!pending.empty())
+		connection->timer.start(std::chrono::ceil<std::chrono::milliseconds>(
+				pending.front().first - now));
+}
+
+MockServerThread::MockServerThread()
+{
+	server.moveToThread(&thread);
+	thread.start();
+}
+
+MockServerThread::~MockServerThread()
+{
+	run([this]() { server.close(); });
+	thread.quit();
+	thread.wait();
+}
+
+quint16 MockServerThread::listen()
+{
+	quint16 port = 0;
+	run([this, &port]() { port = server.listen(); });
+	return port;
+}
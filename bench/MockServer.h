@@ -0,0 +1,198 @@
+/*
+ * Copyright 2023 Clement Vuchener
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef DFHACK_CLIENT_QT_BENCH_MOCK_SERVER_H
+#define DFHACK_CLIENT_QT_BENCH_MOCK_SERVER_H
+
+#include <QMutex>
+#include <QObject>
+#include <QTcpServer>
+#include <QThread>
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <dfhack-client-qt/CommandResult.h>
+
+class QTcpSocket;
+
+/**
+ * Fake DFHack RPC server
+ *
+ * It speaks the same handshake and framing as DFHack remote server, so a
+ * DFHack::Client can connect to it without running Dwarf Fortress.
+ *
+ * BindMethod (id 0) and RunCommand (id 1) are built-in, other methods are
+ * added with \ref addMethod. Like DFHack, ids are assigned per connection:
+ * core methods (empty plugin name) get ids in the order they were added when
+ * the connection is opened, the methods of a plugin are all given ids the
+ * first time one of them is bound.
+ *
+ * The server must be used from the thread it lives in, except for
+ * \ref setOptions and \ref options which are thread-safe. Use
+ * MockServerThread for running it in its own thread.
+ */
+class MockServer: public QObject
+{
+	Q_OBJECT
+public:
+	/**
+	 * Method implementation taking serialized input and writing serialized
+	 * output.
+	 */
+	using Handler = std::function<DFHack::CommandResult(const std::string &in, std::string &out)>;
+
+	struct Options
+	{
+		/**
+		 * Delay between receiving a request and sending its reply.
+		 */
+		std::chrono::microseconds latency = {};
+		/**
+		 * Simulated time spent handling each call. Like DFHack, calls
+		 * from the same connection are handled one after the other,
+		 * but connections are independent.
+		 */
+		std::chrono::microseconds processing_time = {};
+		/**
+		 * Size of the StringMessage returned by built-in "MockPayload"
+		 * method.
+		 */
+		std::size_t reply_size = 0;
+		/**
+		 * Number of ReplyText frames sent before each reply.
+		 */
+		int notification_frames = 0;
+		/**
+		 * Number of fragments in each ReplyText frame.
+		 */
+		int fragments_per_frame = 1;
+		/**
+		 * Size of the text in each fragment.
+		 */
+		std::size_t fragment_size = 16;
+		/**
+		 * Strings returned by built-in "GetVersion" and "GetDFVersion"
+		 * methods.
+		 */
+		std::string version = "mock";
+		std::string df_version = "mock";
+	};
+
+	MockServer(QObject *parent = nullptr);
+	~MockServer() override;
+
+	/**
+	 * Start listening on a loopback port chosen by the system.
+	 *
+	 * \returns the port or 0 on error.
+	 */
+	quint16 listen();
+	/**
+	 * Stop listening and close all connections.
+	 */
+	void close();
+
+	void setOptions(const Options &options);
+	Options options() const;
+
+	/**
+	 * Add a method that can be bound by clients. Methods must be added
+	 * before clients try binding them.
+	 */
+	void addMethod(const std::string &plugin, const std::string &method,
+		       const std::string &input_msg, const std::string &output_msg,
+		       Handler handler);
+
+	/**
+	 * Add a method using typed messages.
+	 *
+	 * \p f must be callable as `CommandResult f(const In &, Out &)`.
+	 */
+	template <typename In, typename Out, typename F>
+	void addMethod(const std::string &plugin, const std::string &method, F &&f)
+	{
+		addMethod(plugin, method, In().GetTypeName(), Out().GetTypeName(),
+			[f = std::forward<F>(f)](const std::string &in_data, std::string &out_data) {
+				In in;
+				Out out;
+				if (!in.ParseFromString(in_data))
+					return DFHack::CommandResult::LinkFailure;
+				auto cr = f(in, out);
+				if (cr == DFHack::CommandResult::Ok)
+					out.SerializeToString(&out_data);
+				return cr;
+			});
+	}
+
+	/**
+	 * Number of calls (bind included) received since the server started.
+	 */
+	quint64 callCount() const;
+
+private:
+	struct Method
+	{
+		std::string plugin, method, input_msg, output_msg;
+		Handler handler;
+	};
+	struct Connection;
+
+	void newConnection();
+	void readyRead(Connection *connection);
+	void handleCall(Connection *connection, int16_t id, const std::string &in);
+	void sendReply(Connection *connection, QByteArray &&data);
+	void sendPending(Connection *connection);
+
+	QTcpServer server;
+	std::vector<Method> methods;
+	std::map<QTcpSocket *, std::unique_ptr<Connection>> connections;
+	mutable QMutex options_mutex;
+	Options opts;
+	std::atomic<quint64> call_count = 0;
+};
+
+/**
+ * Runs a MockServer in its own thread.
+ */
+struct MockServerThread
+{
+	QThread thread;
+	MockServer server;
+
+	MockServerThread();
+	~MockServerThread();
+
+	/**
+	 * Run \p f in the server thread and wait for it to finish.
+	 */
+	template <typename F>
+	void run(F &&f)
+	{
+		QMetaObject::invokeMethod(&server, std::forward<F>(f), Qt::BlockingQueuedConnection);
+	}
+
+	quint16 listen();
+};
+
+#endif
@@ -0,0 +1,180 @@
+/*
+ * Copyright 2023 Clement Vuchener
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "ReplayServer.h"
+
+#include <QTcpSocket>
+#include <QTimer>
+
+#include <QtDebug>
+
+using namespace DFHack;
+using clock_type = std::chrono::steady_clock;
+
+struct ReplayServer::Connection
+{
+	QTcpSocket *socket;
+	const std::vector<CaptureReader::Record> &records;
+	std::size_t next = 0; // next record to replay
+	std::size_t matched = 0; // bytes of the next Sent record already received
+	QByteArray received; // not matched yet
+	// Time of the last request in the capture and when it was received
+	std::chrono::microseconds request_time{0};
+	clock_type::time_point request_received;
+	QTimer timer;
+
+	Connection(QTcpSocket *socket, const std::vector<CaptureReader::Record> &records)
+		: socket(socket)
+		, records(records)
+		, request_received(clock_type::now())
+	{
+		timer.setSingleShot(true);
+		timer.setTimerType(Qt::PreciseTimer);
+	}
+
+	~Connection()
+	{
+		socket->disconnect();
+		socket->abort();
+		socket->deleteLater();
+	}
+};
+
+ReplayServer::ReplayServer(QObject *parent)
+	: QObject(parent)
+	, server(this)
+{
+	QObject::connect(&server, &QTcpServer::newConnection,
+		this, &ReplayServer::newConnection);
+}
+
+ReplayServer::~ReplayServer()
+{
+}
+
+bool ReplayServer::load(const QString &filename)
+{
+	if (!reader.load(filename))
+		return false;
+	captured = reader.connections();
+	next_connection = 0;
+	return !captured.empty();
+}
+
+void ReplayServer::setSpeed(double speed)
+{
+	this->speed = speed;
+}
+
+quint16 ReplayServer::listen(quint16 port)
+{
+	if (!server.listen(QHostAddress::LocalHost, port)) {
+		qCritical() << "Replay server failed to listen:" << server.errorString();
+		return 0;
+	}
+	return server.serverPort();
+}
+
+void ReplayServer::close()
+{
+	server.close();
+	connections.clear();
+}
+
+void ReplayServer::newConnection()
+{
+	while (auto socket = server.nextPendingConnection()) {
+		if (captured.empty()) {
+			socket->abort();
+			socket->deleteLater();
+			continue;
+		}
+		const auto &records = captured[next_connection];
+		next_connection = (next_connection + 1) % captured.size();
+		auto [it, inserted] = connections.emplace(socket, std::make_unique<Connection>(socket, records));
+		auto connection = it->second.get();
+		QObject::connect(socket, &QIODevice::readyRead, this, [this, connection]() {
+			connection->received.append(connection->socket->readAll());
+			advance(connection);
+		});
+		// Queued so that the connection is not destroyed while being used
+		QObject::connect(socket, &QAbstractSocket::disconnected, this, [this, socket]() {
+			connections.erase(socket);
+		}, Qt::QueuedConnection);
+		QObject::connect(&connection->timer, &QTimer::timeout, this, [this, connection]() {
+			advance(connection);
+		});
+	}
+}
+
+void ReplayServer::advance(Connection *connection)
+{
+	auto &records = connection->records;
+	while (connection->next < records.size()) {
+		const auto &record = records[connection->next];
+		if (record.event == Capture::Event::Sent) {
+			// Wait for the whole request
+			auto expected = record.data.substr(connection->matched);
+			auto size = std::min<std::size_t>(expected.size(), connection->received.size());
+			for (std::size_t i = 0; i < size; ++i)
+				if (connection->received[i] != expected[i])
+					++mismatched;
+			connection->received.remove(0, size);
+			connection->matched += size;
+			if (connection->matched < record.data.size())
+				return;
+			connection->matched = 0;
+			connection->request_time = record.time;
+			connection->request_received = clock_type::now();
+		}
+		else {
+			if (speed > 0) {
+				auto due = connection->request_received
+					+ std::chrono::duration_cast<clock_type::duration>(
+						(record.time - connection->request_time) / speed);
+				auto now = clock_type::now();
+				if (due > now) {
+					connection->timer.start(std::chrono::ceil<std::chrono::milliseconds>(due - now));
+					return;
+				}
+			}
+			connection->socket->write(record.data.data(), record.data.size());
+		}
+		++connection->next;
+	}
+}
+
+ReplayServerThread::ReplayServerThread()
+{
+	server.moveToThread(&thread);
+	thread.start();
+}
+
+ReplayServerThread::~ReplayServerThread()
+{
+	run([this]() { server.close(); });
+	thread.quit();
+	thread.wait();
+}
+
+quint16 ReplayServerThread::listen()
+{
+	quint16 port = 0;
+	run([this, &port]() { port = server.listen(); });
+	return port;
+}
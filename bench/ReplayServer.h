@@ -0,0 +1,116 @@
+/*
+ * Copyright 2023 Clement Vuchener
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef DFHACK_CLIENT_QT_BENCH_REPLAY_SERVER_H
+#define DFHACK_CLIENT_QT_BENCH_REPLAY_SERVER_H
+
+#include <QObject>
+#include <QTcpServer>
+#include <QThread>
+
+#include <map>
+#include <memory>
+#include <vector>
+
+#include <dfhack-client-qt/Capture.h>
+
+class QTcpSocket;
+
+/**
+ * Server replaying the replies from a capture recorded by
+ * DFHack::Client::setCapture.
+ *
+ * Each connection replays the next connection of the capture (wrapping
+ * around). The client must make the same calls as when the capture was
+ * recorded: requests are only counted, not parsed. Each reply is sent
+ * after the delay it had from the request preceding it in the capture,
+ * divided by the speed.
+ */
+class ReplayServer: public QObject
+{
+	Q_OBJECT
+public:
+	ReplayServer(QObject *parent = nullptr);
+	~ReplayServer() override;
+
+	bool load(const QString &filename);
+	/**
+	 * Number of connections in the loaded capture.
+	 */
+	std::size_t connectionCount() const { return captured.size(); }
+
+	/**
+	 * Delays are divided by \p speed, 0 sends replies without delay.
+	 * Default is 1.
+	 */
+	void setSpeed(double speed);
+
+	/**
+	 * Start listening on a loopback port, chosen by the system if
+	 * \p port is 0.
+	 *
+	 * \returns the port or 0 on error.
+	 */
+	quint16 listen(quint16 port = 0);
+	void close();
+
+	/**
+	 * Bytes received that did not match the capture, for checking that
+	 * the client made the same requests.
+	 */
+	quint64 mismatchedBytes() const { return mismatched; }
+
+private:
+	struct Connection;
+
+	void newConnection();
+	void advance(Connection *connection);
+
+	QTcpServer server;
+	DFHack::CaptureReader reader;
+	std::vector<std::vector<DFHack::CaptureReader::Record>> captured;
+	std::size_t next_connection = 0;
+	double speed = 1.0;
+	quint64 mismatched = 0;
+	std::map<QTcpSocket *, std::unique_ptr<Connection>> connections;
+};
+
+/**
+ * Runs a ReplayServer in its own thread.
+ */
+struct ReplayServerThread
+{
+	QThread thread;
+	ReplayServer server;
+
+	ReplayServerThread();
+	~ReplayServerThread();
+
+	/**
+	 * Run \p f in the server thread and wait for it to finish.
+	 */
+	template <typename F>
+	void run(F &&f)
+	{
+		QMetaObject::invokeMethod(&server, std::forward<F>(f), Qt::BlockingQueuedConnection);
+	}
+
+	quint16 listen();
+};
+
+#endif
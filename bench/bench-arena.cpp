@@ -0,0 +1,99 @@
+/*
+ * Copyright 2023 Clement Vuchener
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <QCoreApplication>
+
+#include <dfhack-client-qt/Basic.h>
+
+#include "BenchUtils.h"
+#include "MockData.h"
+#include "MockServer.h"
+
+#include <google/protobuf/arena.h>
+
+#include <QtDebug>
+
+static constexpr int UnitCount = 5000;
+
+int main(int argc, char *argv[])
+{
+	QCoreApplication app(argc, argv);
+	int iterations = bench::iterations_from_args(argc, argv, 50);
+
+	MockServerThread server_thread;
+	server_thread.run([]() { bench::count_allocations(false); });
+	server_thread.server.addMethod<dfproto::ListUnitsIn, dfproto::ListUnitsOut>("", "ListUnits",
+		[](const dfproto::ListUnitsIn &in, dfproto::ListUnitsOut &out) {
+			bench::make_units(out, in, UnitCount);
+			return DFHack::CommandResult::Ok;
+		});
+	auto port = server_thread.listen();
+	if (port == 0)
+		return -1;
+
+	dfproto::ListUnitsIn in;
+	in.mutable_mask()->set_labors(true);
+	in.mutable_mask()->set_skills(true);
+	in.mutable_mask()->set_profession(true);
+
+	// Parsing alone, without the socket
+	dfproto::ListUnitsOut units;
+	bench::make_units(units, in, UnitCount);
+	auto serialized = units.SerializeAsString();
+	auto parse_heap = bench::measure(iterations, [&]() {
+		dfproto::ListUnitsOut out;
+		if (!out.ParseFromString(serialized) || out.value_size() != UnitCount)
+			qFatal("Parse failed");
+	});
+	bench::report("parse ListUnitsOut", "units=5000 heap", parse_heap);
+	auto parse_arena = bench::measure(iterations, [&]() {
+		google::protobuf::Arena arena;
+		auto out = google::protobuf::Arena::CreateMessage<dfproto::ListUnitsOut>(&arena);
+		if (!out->ParseFromString(serialized) || out->value_size() != UnitCount)
+			qFatal("Parse failed");
+	});
+	bench::report("parse ListUnitsOut", "units=5000 arena", parse_arena);
+
+	bench::ClientThread client_thread;
+	DFHack::Client &client = client_thread.client;
+	if (!bench::sync(client.connect("localhost", port))) {
+		qCritical() << "Failed to connect to mock server";
+		return -1;
+	}
+	DFHack::Basic basic;
+	if (!bench::sync(basic.listUnits.bind(client))) {
+		qCritical() << "Failed to bind ListUnits";
+		return -1;
+	}
+
+	// Includes destroying the reply
+	for (auto [allocation, name]: {
+			std::pair{DFHack::Client::ReplyAllocation::Heap, "heap"},
+			std::pair{DFHack::Client::ReplyAllocation::Arena, "arena"}}) {
+		client.setReplyAllocation(allocation);
+		auto result = bench::measure(iterations, [&]() {
+			auto reply = bench::sync(basic.listUnits(client, in).first);
+			if (!reply || reply->value_size() != UnitCount)
+				qFatal("ListUnits failed");
+		});
+		bench::report("listUnits", std::string("units=5000 ") + name, result);
+	}
+
+	client.disconnect().waitForFinished();
+	return 0;
+}
@@ -0,0 +1,100 @@
+/*
+ * Copyright 2023 Clement Vuchener
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <QCoreApplication>
+
+#include <dfhack-client-qt/Basic.h>
+
+#include "BenchUtils.h"
+#include "MockServer.h"
+
+#include <QtDebug>
+
+using namespace std::literals;
+
+static constexpr int MethodCount = 30;
+
+using MockFunction = DFHack::Function<dfproto::EmptyMessage, dfproto::StringMessage>;
+
+int main(int argc, char *argv[])
+{
+	QCoreApplication app(argc, argv);
+	int iterations = bench::iterations_from_args(argc, argv, 20);
+
+	MockServerThread server_thread;
+	server_thread.run([]() { bench::count_allocations(false); });
+	std::vector<MockFunction> functions;
+	std::vector<dfproto::CoreBindRequest> requests;
+	functions.reserve(MethodCount);
+	for (int i = 0; i < MethodCount; ++i) {
+		auto name = "Mock" + std::to_string(i);
+		server_thread.server.addMethod<dfproto::EmptyMessage, dfproto::StringMessage>("", name,
+			[](const dfproto::EmptyMessage &, dfproto::StringMessage &) {
+				return DFHack::CommandResult::Ok;
+			});
+		functions.emplace_back("", name);
+		requests.push_back(functions.back().bindRequest());
+	}
+	auto port = server_thread.listen();
+	if (port == 0)
+		return -1;
+	server_thread.server.setOptions({.latency = 1ms});
+
+	bench::ClientThread client_thread;
+	DFHack::Client &client = client_thread.client;
+	auto connect = [&]() {
+		if (!bench::sync(client.connect("localhost", port)))
+			qFatal("Failed to connect to mock server");
+	};
+
+	// Only GetVersion and GetDFVersion exist on the mock server
+	connect();
+	auto failures = bench::sync(DFHack::Basic().bindAll(client));
+	if (failures.size() != 7)
+		qFatal("Basic::bindAll reported %d failures instead of 7", int(failures.size()));
+	for (const auto &[request, cr]: failures)
+		if (cr != DFHack::CommandResult::Failure)
+			qFatal("Unexpected result for %s", request.method().c_str());
+	client.disconnect().waitForFinished();
+
+	// Bindings are invalidated when disconnecting, every run binds again
+	auto baseline = bench::measure(iterations, [&]() {
+		connect();
+		client.disconnect().waitForFinished();
+	});
+	bench::report("connect", "latency=1ms", baseline);
+
+	auto sequential = bench::measure(iterations, [&]() {
+		connect();
+		for (const auto &function: functions)
+			if (!bench::sync(function.bind(client)))
+				qFatal("Bind failed");
+		client.disconnect().waitForFinished();
+	});
+	bench::report("connect+bind", "methods=30 latency=1ms sequential", sequential);
+
+	auto batched = bench::measure(iterations, [&]() {
+		connect();
+		if (!bench::sync(client.bindAll(requests)).empty())
+			qFatal("Bind failed");
+		client.disconnect().waitForFinished();
+	});
+	bench::report("connect+bind", "methods=30 latency=1ms bindAll", batched);
+
+	return 0;
+}
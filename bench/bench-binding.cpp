@@ -0,0 +1,107 @@
+/*
+ * Copyright 2023 Clement Vuchener
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <QCoreApplication>
+
+#include <dfhack-client-qt/Client.h>
+#include <dfhack-client-qt/Function.h>
+
+#include "BenchUtils.h"
+#include "MockServer.h"
+
+#include <thread>
+
+#include <QtDebug>
+
+static constexpr int ThreadCount = 16;
+static constexpr int LookupsPerThread = 10000;
+static constexpr int CallsPerThread = 20;
+
+/**
+ * Run \p f \p count times in each of ThreadCount threads.
+ */
+template <typename F>
+static void run_threads(int count, F &&f)
+{
+	std::vector<std::jthread> threads;
+	threads.reserve(ThreadCount);
+	for (int i = 0; i < ThreadCount; ++i)
+		threads.emplace_back([count, &f]() {
+			for (int j = 0; j < count; ++j)
+				f();
+		});
+}
+
+int main(int argc, char *argv[])
+{
+	QCoreApplication app(argc, argv);
+	int iterations = bench::iterations_from_args(argc, argv, 20);
+
+	MockServerThread server_thread;
+	server_thread.run([]() { bench::count_allocations(false); });
+	auto port = server_thread.listen();
+	if (port == 0)
+		return -1;
+
+	bench::ClientThread client_thread;
+	DFHack::Client &client = client_thread.client;
+	if (!bench::sync(client.connect("localhost", port))) {
+		qCritical() << "Failed to connect to mock server";
+		return -1;
+	}
+	client.setPipelineDepth(ThreadCount);
+
+	const DFHack::Function<dfproto::EmptyMessage, dfproto::StringMessage> mock_payload = {"", "MockPayload"};
+	dfproto::CoreBindRequest bind_request;
+	bind_request.set_method("MockPayload");
+	bind_request.set_input_msg(dfproto::EmptyMessage().GetTypeName());
+	bind_request.set_output_msg(dfproto::StringMessage().GetTypeName());
+	bind_request.set_plugin("");
+	if (!bench::sync(mock_payload.bind(client))) {
+		qCritical() << "Failed to bind MockPayload";
+		return -1;
+	}
+
+	const std::string params = "threads=16 lookups=16x10000";
+	auto map_lookup = bench::measure(iterations, [&]() {
+		run_threads(LookupsPerThread, [&]() {
+			if (!client.getBinding(bind_request))
+				qFatal("Client::getBinding failed");
+		});
+	});
+	bench::report("Client::getBinding", params, map_lookup);
+
+	auto cached_lookup = bench::measure(iterations, [&]() {
+		run_threads(LookupsPerThread, [&]() {
+			if (!mock_payload.binding(client))
+				qFatal("Function::binding failed");
+		});
+	});
+	bench::report("Function::binding", params, cached_lookup);
+
+	auto calls = bench::measure(iterations, [&]() {
+		run_threads(CallsPerThread, [&]() {
+			if (!bench::sync(mock_payload(client).first))
+				qFatal("Function::operator() failed");
+		});
+	});
+	bench::report("Function::operator()", "threads=16 calls=16x20 depth=16", calls);
+
+	client.disconnect().waitForFinished();
+	return 0;
+}
@@ -0,0 +1,82 @@
+/*
+ * Copyright 2023 Clement Vuchener
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <QCoreApplication>
+
+#include <dfhack-client-qt/BlockingClient.h>
+#include <dfhack-client-qt/Client.h>
+#include <dfhack-client-qt/Function.h>
+
+#include "BenchUtils.h"
+#include "MockServer.h"
+
+#include <QtDebug>
+
+using MockFunction = DFHack::Function<dfproto::EmptyMessage, dfproto::StringMessage>;
+
+int main(int argc, char *argv[])
+{
+	QCoreApplication app(argc, argv);
+	int iterations = bench::iterations_from_args(argc, argv, 5000);
+
+	MockServerThread server_thread;
+	server_thread.run([]() { bench::count_allocations(false); });
+	auto port = server_thread.listen();
+	if (port == 0)
+		return -1;
+	server_thread.server.setOptions({.reply_size = 64});
+
+	const MockFunction mock_payload = {"", "MockPayload"};
+
+	// Threaded client, the calling thread waits for each future
+	{
+		bench::ClientThread client_thread;
+		DFHack::Client &client = client_thread.client;
+		if (!bench::sync(client.connect("localhost", port))) {
+			qCritical() << "Failed to connect to mock server";
+			return -1;
+		}
+		if (!bench::sync(mock_payload.bind(client))) {
+			qCritical() << "Failed to bind mock methods";
+			return -1;
+		}
+		auto result = bench::measure(iterations, [&]() {
+			if (!bench::sync(mock_payload(client).first))
+				qFatal("Call failed");
+		});
+		bench::report("sync call", "Client", result);
+		client.disconnect().waitForFinished();
+	}
+
+	// Blocking client, I/O in the calling thread
+	{
+		DFHack::BlockingClient client;
+		if (!client.connect("localhost", port)) {
+			qCritical() << "Failed to connect to mock server";
+			return -1;
+		}
+		auto result = bench::measure(iterations, [&]() {
+			if (!mock_payload(client))
+				qFatal("Call failed");
+		});
+		bench::report("sync call", "BlockingClient", result);
+		client.disconnect();
+	}
+
+	return 0;
+}
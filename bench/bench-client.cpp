@@ -0,0 +1,125 @@
+/*
+ * Copyright 2023 Clement Vuchener
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <QCoreApplication>
+
+#include <dfhack-client-qt/Client.h>
+#include <dfhack-client-qt/Function.h>
+
+#include "BenchUtils.h"
+#include "MockServer.h"
+
+#include <QtDebug>
+
+using namespace std::literals;
+
+struct Scenario
+{
+	std::string name;
+	MockServer::Options options;
+	int iterations;
+};
+
+int main(int argc, char *argv[])
+{
+	QCoreApplication app(argc, argv);
+	int iterations = bench::iterations_from_args(argc, argv, 2000);
+
+	MockServerThread server_thread;
+	server_thread.run([]() { bench::count_allocations(false); });
+	auto port = server_thread.listen();
+	if (port == 0)
+		return -1;
+
+	bench::ClientThread client_thread;
+	DFHack::Client &client = client_thread.client;
+	if (!bench::sync(client.connect("localhost", port))) {
+		qCritical() << "Failed to connect to mock server";
+		return -1;
+	}
+
+	const DFHack::Function<dfproto::EmptyMessage, dfproto::StringMessage> mock_payload = {"", "MockPayload"};
+	dfproto::CoreBindRequest bind_request;
+	bind_request.set_method("MockPayload");
+	bind_request.set_input_msg(dfproto::EmptyMessage().GetTypeName());
+	bind_request.set_output_msg(dfproto::StringMessage().GetTypeName());
+	bind_request.set_plugin("");
+
+	if (!bench::sync(mock_payload.bind(client))) {
+		qCritical() << "Failed to bind MockPayload";
+		return -1;
+	}
+	auto binding = client.getBinding(bind_request);
+	auto id = static_cast<int16_t>(binding->id);
+
+	std::vector<Scenario> scenarios = {
+		{"reply=16B", {.reply_size = 16}, iterations},
+		{"reply=64KiB", {.reply_size = 64*1024}, iterations},
+		{"reply=1MiB", {.reply_size = 1024*1024}, iterations / 10},
+		{"reply=16B latency=1ms", {.latency = 1ms, .reply_size = 16}, iterations / 10},
+		{"reply=16B notifications=10x10", {
+			.reply_size = 16,
+			.notification_frames = 10,
+			.fragments_per_frame = 10,
+		}, iterations},
+	};
+
+	const dfproto::EmptyMessage in;
+	for (const auto &scenario: scenarios) {
+		server_thread.server.setOptions(scenario.options);
+
+		auto call = bench::measure(scenario.iterations, [&]() {
+			auto [reply, notifications] = client.call(id, in,
+					std::make_shared<dfproto::StringMessage>());
+			if (!bench::sync(std::move(reply)))
+				qFatal("Client::call failed");
+		});
+		bench::report("Client::call", scenario.name, call);
+
+		auto function = bench::measure(scenario.iterations, [&]() {
+			auto [reply, notifications] = mock_payload(client);
+			if (!bench::sync(std::move(reply)))
+				qFatal("Function::operator() failed");
+		});
+		bench::report("Function::operator()", scenario.name, function);
+	}
+
+	client.setLowDelay(true);
+	server_thread.server.setOptions({.reply_size = 16});
+	auto low_delay = bench::measure(iterations, [&]() {
+		auto [reply, notifications] = mock_payload(client);
+		if (!bench::sync(std::move(reply)))
+			qFatal("Function::operator() failed");
+	});
+	bench::report("Function::operator()", "reply=16B low-delay", low_delay);
+
+	auto get_binding = bench::measure(iterations * 100, [&]() {
+		if (!client.getBinding(bind_request))
+			qFatal("Client::getBinding failed");
+	});
+	bench::report("Client::getBinding", "cached", get_binding);
+
+	auto function_binding = bench::measure(iterations * 100, [&]() {
+		if (!mock_payload.binding(client))
+			qFatal("Function::binding failed");
+	});
+	bench::report("Function::binding", "cached", function_binding);
+
+	client.disconnect().waitForFinished();
+	return 0;
+}
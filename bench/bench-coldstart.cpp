@@ -0,0 +1,107 @@
+/*
+ * Copyright 2023 Clement Vuchener
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <QCoreApplication>
+#include <QDir>
+
+#include <dfhack-client-qt/BindingCache.h>
+#include <dfhack-client-qt/Function.h>
+
+#include "BenchUtils.h"
+#include "MockServer.h"
+
+#include <QtDebug>
+
+using namespace std::literals;
+
+static constexpr int MethodCount = 5;
+
+using MockFunction = DFHack::Function<dfproto::EmptyMessage, dfproto::StringMessage>;
+
+int main(int argc, char *argv[])
+{
+	QCoreApplication app(argc, argv);
+	int iterations = bench::iterations_from_args(argc, argv, 20);
+
+	MockServerThread server_thread;
+	server_thread.run([]() { bench::count_allocations(false); });
+	std::vector<MockFunction> functions;
+	functions.reserve(MethodCount);
+	for (int i = 0; i < MethodCount; ++i) {
+		auto name = "Mock" + std::to_string(i);
+		server_thread.server.addMethod<dfproto::EmptyMessage, dfproto::StringMessage>("", name,
+			[](const dfproto::EmptyMessage &, dfproto::StringMessage &) {
+				return DFHack::CommandResult::Ok;
+			});
+		functions.emplace_back("", name);
+	}
+	auto port = server_thread.listen();
+	if (port == 0)
+		return -1;
+	server_thread.server.setOptions({.latency = 2ms});
+
+	bench::ClientThread client_thread;
+	DFHack::Client &client = client_thread.client;
+
+	// A short-lived tool: connect, call every function once, disconnect
+	auto run_tool = [&]() {
+		if (!bench::sync(client.connect("localhost", port)))
+			qFatal("Failed to connect to mock server");
+		std::vector<QFuture<DFHack::CallReply<dfproto::StringMessage>>> replies;
+		for (const auto &function: functions)
+			replies.push_back(function(client).first);
+		for (auto &reply: replies)
+			if (!bench::sync(std::move(reply)))
+				qFatal("Call failed");
+		client.disconnect().waitForFinished();
+	};
+
+	auto no_cache = bench::measure(iterations, run_tool);
+	bench::report("cold start", "methods=5 latency=2ms no cache", no_cache);
+
+	// First run fills the cache, then it goes through a file as it would
+	// between two runs of a tool.
+	auto filename = QDir::temp().filePath("dfhack-client-qt-bench-bindings.json");
+	auto cache = std::make_shared<DFHack::BindingCache>();
+	client.setBindingCache(cache);
+	run_tool();
+	if (!cache->save(filename))
+		qFatal("Failed to save binding cache");
+	cache = std::make_shared<DFHack::BindingCache>();
+	if (!cache->load(filename))
+		qFatal("Failed to load binding cache");
+	QFile::remove(filename);
+	client.setBindingCache(cache);
+
+	auto cached = bench::measure(iterations, run_tool);
+	bench::report("cold start", "methods=5 latency=2ms cache", cached);
+
+	// Stale ids must fall back to binding
+	auto version = cache->serverVersion(QString("localhost:%1").arg(port));
+	if (!version)
+		qFatal("Server version was not cached");
+	for (const auto &function: functions)
+		cache->setId(*version, function.bindRequest(), 1000);
+	auto stale = bench::measure(iterations, run_tool);
+	bench::report("cold start", "methods=5 latency=2ms stale cache", stale);
+	for (const auto &function: functions)
+		if (cache->id(*version, function.bindRequest()).value_or(1000) == 1000)
+			qFatal("Stale id was not replaced");
+
+	return 0;
+}
@@ -0,0 +1,109 @@
+/*
+ * Copyright 2023 Clement Vuchener
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <QCoreApplication>
+
+#include <dfhack-client-qt/Client.h>
+#include <dfhack-client-qt/Coroutine.h>
+#include <dfhack-client-qt/Function.h>
+#include <dfhack-client-qt/FutureCoroutine.h>
+
+#include "BenchUtils.h"
+#include "MockServer.h"
+
+#include <QtDebug>
+
+static constexpr int ChainLength = 10;
+
+using MockFunction = DFHack::Function<dfproto::EmptyMessage, dfproto::StringMessage>;
+using MockReply = DFHack::CallReply<dfproto::StringMessage>;
+
+// Each call is sent from the continuation of the previous one
+static QFuture<MockReply> then_chain(DFHack::Client &client, const MockFunction &fn)
+{
+	auto future = fn(client).first;
+	for (int i = 1; i < ChainLength; ++i)
+		future = future.then([&client, &fn](MockReply reply) {
+			if (!reply)
+				throw std::runtime_error("Call failed");
+			return fn(client).first;
+		}).unwrap();
+	return future;
+}
+
+static QFuture<bool> coroutine_chain(DFHack::Client &client, const MockFunction &fn, QObject *context)
+{
+	for (int i = 0; i < ChainLength; ++i)
+		if (!co_await fn.async(client).resumeOn(context))
+			co_return false;
+	co_return true;
+}
+
+int main(int argc, char *argv[])
+{
+	QCoreApplication app(argc, argv);
+	int iterations = bench::iterations_from_args(argc, argv, 500);
+
+	MockServerThread server_thread;
+	server_thread.run([]() { bench::count_allocations(false); });
+	auto port = server_thread.listen();
+	if (port == 0)
+		return -1;
+
+	bench::ClientThread client_thread;
+	DFHack::Client &client = client_thread.client;
+	if (!bench::sync(client.connect("localhost", port))) {
+		qCritical() << "Failed to connect to mock server";
+		return -1;
+	}
+
+	const MockFunction mock_payload = {"", "MockPayload"};
+	if (!bench::sync(mock_payload.bind(client))) {
+		qCritical() << "Failed to bind mock methods";
+		return -1;
+	}
+	server_thread.server.setOptions({.reply_size = 64});
+
+	auto then_result = bench::measure(iterations, [&]() {
+		if (!bench::sync(then_chain(client, mock_payload)))
+			qFatal("Chain failed");
+	});
+	bench::report("10-call chain", "QFuture::then", then_result);
+
+	auto coroutine_result = bench::measure(iterations, [&]() {
+		if (!bench::sync(coroutine_chain(client, mock_payload, nullptr)))
+			qFatal("Chain failed");
+	});
+	bench::report("10-call chain", "coroutine", coroutine_result);
+
+	// Resuming in another thread costs an event per step
+	QThread executor_thread;
+	QObject executor;
+	executor.moveToThread(&executor_thread);
+	executor_thread.start();
+	auto executor_result = bench::measure(iterations, [&]() {
+		if (!bench::sync(coroutine_chain(client, mock_payload, &executor)))
+			qFatal("Chain failed");
+	});
+	bench::report("10-call chain", "coroutine executor=thread", executor_result);
+	executor_thread.quit();
+	executor_thread.wait();
+
+	client.disconnect().waitForFinished();
+	return 0;
+}
@@ -0,0 +1,136 @@
+/*
+ * Copyright 2023 Clement Vuchener
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <QCoreApplication>
+
+#include <dfhack-client-qt/Client.h>
+#include <dfhack-client-qt/Function.h>
+
+#include "BenchUtils.h"
+#include "MockServer.h"
+
+#include <QtDebug>
+
+#include <vector>
+
+using namespace std::literals;
+
+static constexpr auto ProcessingTime = 20ms;
+static constexpr auto Deadline = 5ms;
+
+int main(int argc, char *argv[])
+{
+	QCoreApplication app(argc, argv);
+	int iterations = bench::iterations_from_args(argc, argv, 20);
+
+	MockServerThread server_thread;
+	auto &server = server_thread.server;
+	server_thread.run([]() {
+		bench::count_allocations(false);
+	});
+	auto port = server_thread.listen();
+	if (port == 0)
+		return -1;
+
+	bench::ClientThread client_thread;
+	DFHack::Client &client = client_thread.client;
+	if (!bench::sync(client.connect("localhost", port))) {
+		qCritical() << "Failed to connect to mock server";
+		return -1;
+	}
+
+	const DFHack::Function<dfproto::EmptyMessage, dfproto::StringMessage> mock_payload = {"", "MockPayload"};
+	if (!bench::sync(mock_payload.bind(client))) {
+		qCritical() << "Failed to bind mock methods";
+		return -1;
+	}
+	server.setOptions({.processing_time = ProcessingTime, .reply_size = 64});
+
+	// A call expiring behind a slow call is not sent
+	{
+		auto count = server.callCount();
+		auto slow = mock_payload(client).first;
+		DFHack::CallOptions options;
+		options.deadline = QDeadlineTimer(Deadline);
+		auto [reply, text] = mock_payload(client, {}, options);
+		if (bench::sync(std::move(reply)).cr != DFHack::CommandResult::Timeout)
+			qFatal("Queued call did not time out");
+		bench::sync(std::move(slow));
+		if (server.callCount() != count + 1)
+			qFatal("Expired call was sent");
+	}
+	// Canceled calls are not sent and their futures stay canceled
+	{
+		auto count = server.callCount();
+		auto slow = mock_payload(client).first;
+		std::vector<QFuture<DFHack::CallReply<dfproto::StringMessage>>> canceled;
+		for (int i = 0; i < 10; ++i) {
+			auto reply = mock_payload(client).first;
+			reply.cancel();
+			canceled.push_back(std::move(reply));
+		}
+		bench::sync(std::move(slow));
+		bench::sync(mock_payload(client).first);
+		if (server.callCount() != count + 2)
+			qFatal("Canceled calls were sent");
+		for (const auto &reply: canceled)
+			if (!reply.isCanceled() || reply.resultCount() != 0)
+				qFatal("Canceled call finished with a result");
+	}
+
+	for (bool deadline: {false, true}) {
+		auto result = bench::measure(iterations, [&]() {
+			auto slow = mock_payload(client).first;
+			DFHack::CallOptions options;
+			if (deadline)
+				options.deadline = QDeadlineTimer(Deadline);
+			auto [reply, text] = mock_payload(client, {}, options);
+			bench::sync(std::move(reply));
+			bench::sync(std::move(slow));
+		});
+		bench::report("call behind slow call",
+			deadline ? "deadline=" + std::to_string(Deadline.count()) + "ms" : "no deadline",
+			result);
+	}
+
+	// A sent call exceeding its deadline closes the connection and the
+	// client reconnects
+	client.setRecycleOnTimeout(true);
+	{
+		auto result = bench::measure(iterations, [&]() {
+			// Bind first, so that the call does not expire while
+			// waiting for its binding
+			if (!bench::sync(mock_payload.bind(client)))
+				qFatal("Failed to bind after reconnecting");
+			DFHack::CallOptions options;
+			options.deadline = QDeadlineTimer(Deadline);
+			auto [reply, text] = mock_payload(client, {}, options);
+			if (bench::sync(std::move(reply)).cr != DFHack::CommandResult::Timeout)
+				qFatal("Sent call did not time out");
+			if (!bench::sync(client.connect("localhost", port)))
+				qFatal("Failed to reconnect");
+		});
+		bench::report("timeout, reconnect and bind", "recycle=on", result);
+	}
+	server.setOptions({.reply_size = 64});
+	if (!bench::sync(mock_payload(client).first))
+		qFatal("Call after reconnecting failed");
+
+	client.disconnect().waitForFinished();
+	return 0;
+}
@@ -0,0 +1,134 @@
+/*
+ * Copyright 2023 Clement Vuchener
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <QCoreApplication>
+
+#include <dfhack-client-qt/Dictionaries.h>
+
+#include "BenchUtils.h"
+#include "MockData.h"
+#include "MockServer.h"
+
+#include <QtDebug>
+
+static constexpr int UnitCount = 1000;
+
+// What tools did before: scan the enum lists for each value
+static std::string_view find_name(const google::protobuf::RepeatedPtrField<dfproto::EnumItemName> &items, int value)
+{
+	for (const auto &item: items)
+		if (item.value() == value)
+			return item.name();
+	return {};
+}
+
+int main(int argc, char *argv[])
+{
+	QCoreApplication app(argc, argv);
+	int iterations = bench::iterations_from_args(argc, argv, 200);
+
+	MockServerThread server_thread;
+	server_thread.run([]() { bench::count_allocations(false); });
+	server_thread.server.addMethod<dfproto::EmptyMessage, dfproto::ListEnumsOut>("", "ListEnums",
+		[](const dfproto::EmptyMessage &, dfproto::ListEnumsOut &out) {
+			bench::make_enums(out);
+			return DFHack::CommandResult::Ok;
+		});
+	server_thread.server.addMethod<dfproto::EmptyMessage, dfproto::ListJobSkillsOut>("", "ListJobSkills",
+		[](const dfproto::EmptyMessage &, dfproto::ListJobSkillsOut &out) {
+			bench::make_job_skills(out);
+			return DFHack::CommandResult::Ok;
+		});
+	auto port = server_thread.listen();
+	if (port == 0)
+		return -1;
+
+	bench::ClientThread client_thread;
+	DFHack::Client &client = client_thread.client;
+	DFHack::Dictionaries dictionaries(client);
+	dictionaries.moveToThread(&client_thread.thread);
+	if (!bench::sync(client.connect("localhost", port))) {
+		qCritical() << "Failed to connect to mock server";
+		return -1;
+	}
+	if (bench::sync(dictionaries.refresh()) != DFHack::CommandResult::Ok)
+		qFatal("Failed to load dictionaries");
+
+	dfproto::ListUnitsIn in;
+	in.mutable_mask()->set_labors(true);
+	in.mutable_mask()->set_profession(true);
+	dfproto::ListUnitsOut units;
+	bench::make_units(units, in, UnitCount);
+	dfproto::ListEnumsOut enums;
+	bench::make_enums(enums);
+
+	std::size_t naive_length = 0;
+	auto naive = bench::measure(iterations, [&]() {
+		naive_length = 0;
+		for (const auto &unit: units.value()) {
+			for (auto [word, items]: {
+					std::pair{unit.flags1(), &enums.unit_flags1()},
+					std::pair{unit.flags2(), &enums.unit_flags2()},
+					std::pair{unit.flags3(), &enums.unit_flags3()}})
+				for (int bit = 0; bit < 32; ++bit)
+					if (word & (1u << bit))
+						naive_length += find_name(*items, bit).size();
+			for (int labor: unit.labors())
+				naive_length += find_name(enums.unit_labor(), labor).size();
+			naive_length += find_name(enums.profession(), unit.profession()).size();
+		}
+	});
+	bench::report("names", "units=1000 linear scan", naive);
+
+	using Enum = DFHack::Dictionaries::Enum;
+	std::size_t dict_length = 0;
+	auto dict = bench::measure(iterations, [&]() {
+		dict_length = 0;
+		auto add = [&dict_length](int, std::string_view name) { dict_length += name.size(); };
+		for (const auto &unit: units.value()) {
+			dictionaries.forEachFlag(Enum::UnitFlags1, unit.flags1(), add);
+			dictionaries.forEachFlag(Enum::UnitFlags2, unit.flags2(), add);
+			dictionaries.forEachFlag(Enum::UnitFlags3, unit.flags3(), add);
+			for (int labor: unit.labors())
+				dict_length += dictionaries.name(Enum::UnitLabor, labor).size();
+			dict_length += dictionaries.name(Enum::Profession, unit.profession()).size();
+		}
+	});
+	bench::report("names", "units=1000 Dictionaries", dict);
+	if (dict_length != naive_length)
+		qFatal("Dictionaries names differ from linear scan");
+
+	auto same_version = bench::measure(iterations, [&]() {
+		if (bench::sync(dictionaries.refresh()) != DFHack::CommandResult::Ok)
+			qFatal("Failed to refresh dictionaries");
+	});
+	bench::report("refresh", "same DF version", same_version);
+
+	int version = 0;
+	auto new_version = bench::measure(iterations, [&]() {
+		auto options = server_thread.server.options();
+		options.df_version = "mock " + std::to_string(++version);
+		server_thread.server.setOptions(options);
+		if (bench::sync(dictionaries.refresh()) != DFHack::CommandResult::Ok)
+			qFatal("Failed to refresh dictionaries");
+	});
+	bench::report("refresh", "new DF version", new_version);
+
+	client.disconnect().waitForFinished();
+	return 0;
+}
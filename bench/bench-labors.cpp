@@ -0,0 +1,114 @@
+/*
+ * Copyright 2023 Clement Vuchener
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <QCoreApplication>
+
+#include <dfhack-client-qt/LaborWriter.h>
+
+#include "BenchUtils.h"
+#include "MockData.h"
+#include "MockServer.h"
+
+#include <QtDebug>
+
+static constexpr int UnitCount = 200;
+static constexpr int ProfileLabors = 20;
+static constexpr int ToggleCount = 1000;
+
+int main(int argc, char *argv[])
+{
+	QCoreApplication app(argc, argv);
+	int iterations = bench::iterations_from_args(argc, argv, 10);
+
+	MockServerThread server_thread;
+	server_thread.run([]() { bench::count_allocations(false); });
+	std::atomic<int> calls = 0, changes = 0;
+	server_thread.server.addMethod<dfproto::SetUnitLaborsIn, dfproto::EmptyMessage>("", "SetUnitLabors",
+		[&](const dfproto::SetUnitLaborsIn &in, dfproto::EmptyMessage &) {
+			++calls;
+			changes += in.change_size();
+			return DFHack::CommandResult::Ok;
+		});
+	auto port = server_thread.listen();
+	if (port == 0)
+		return -1;
+
+	bench::ClientThread client_thread;
+	DFHack::Client &client = client_thread.client;
+	if (!bench::sync(client.connect("localhost", port))) {
+		qCritical() << "Failed to connect to mock server";
+		return -1;
+	}
+
+	// Apply a profile of 20 labors to 200 dwarves
+	DFHack::Basic basic;
+	auto one_by_one = bench::measure(iterations, [&]() {
+		QList<QFuture<DFHack::CallReply<dfproto::EmptyMessage>>> futures;
+		for (int unit = 0; unit < UnitCount; ++unit)
+			for (int labor = 0; labor < ProfileLabors; ++labor) {
+				dfproto::SetUnitLaborsIn in;
+				auto change = in.add_change();
+				change->set_unit_id(bench::FirstUnitId + unit);
+				change->set_labor(labor);
+				change->set_value(labor % 2 == 0);
+				futures.append(basic.setUnitLabors(client, in).first);
+			}
+		for (auto &future: futures)
+			if (!bench::sync(std::move(future)))
+				qFatal("SetUnitLabors failed");
+	});
+	bench::report("profile", "units=200 labors=20 one call each", one_by_one);
+
+	DFHack::LaborWriter writer(client);
+	writer.moveToThread(&client_thread.thread);
+	calls = 0;
+	auto batched = bench::measure(iterations, [&]() {
+		QList<QFuture<DFHack::CommandResult>> futures;
+		for (int unit = 0; unit < UnitCount; ++unit)
+			for (int labor = 0; labor < ProfileLabors; ++labor)
+				futures.append(writer.set(bench::FirstUnitId + unit, labor, labor % 2 == 0));
+		writer.flush();
+		for (auto &future: futures)
+			if (bench::sync(std::move(future)) != DFHack::CommandResult::Ok)
+				qFatal("LaborWriter failed");
+	});
+	bench::report("profile", "units=200 labors=20 LaborWriter", batched);
+	qInfo().noquote() << QString("LaborWriter: %1 call(s) per profile").arg(double(calls) / (iterations + iterations / 10));
+
+	// Clicking on the same few labors, with labors known from ListUnits
+	dfproto::ListUnitsIn in;
+	in.mutable_mask()->set_labors(true);
+	dfproto::ListUnitsOut units;
+	bench::make_units(units, in, UnitCount);
+	writer.updateKnown(units);
+	calls = changes = 0;
+	auto toggles = bench::measure(iterations, [&]() {
+		QList<QFuture<DFHack::CommandResult>> futures;
+		for (int i = 0; i < ToggleCount; ++i)
+			futures.append(writer.set(bench::FirstUnitId + i % 10, i % 3, i % 2 == 0));
+		writer.flush();
+		for (auto &future: futures)
+			bench::sync(std::move(future));
+	});
+	bench::report("toggles", "clicks=1000 LaborWriter", toggles);
+	qInfo().noquote() << QString("LaborWriter: %1 changes sent in %2 calls for %3 clicks")
+		.arg(int(changes)).arg(int(calls)).arg(ToggleCount * (iterations + iterations / 10));
+
+	client.disconnect().waitForFinished();
+	return 0;
+}
@@ -0,0 +1,93 @@
+/*
+ * Copyright 2023 Clement Vuchener
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <QCoreApplication>
+
+#include <dfhack-client-qt/Basic.h>
+#include <dfhack-client-qt/Client.h>
+#include <dfhack-client-qt/Function.h>
+
+#include "BenchUtils.h"
+#include "MockData.h"
+#include "MockServer.h"
+
+#include <QtDebug>
+
+#include <atomic>
+
+int main(int argc, char *argv[])
+{
+	QCoreApplication app(argc, argv);
+	int iterations = bench::iterations_from_args(argc, argv, 20);
+
+	MockServerThread server_thread;
+	server_thread.run([]() { bench::count_allocations(false); });
+	std::atomic<int> unit_count = 0;
+	server_thread.server.addMethod<dfproto::ListUnitsIn, dfproto::ListUnitsOut>("", "ListUnits",
+		[&unit_count](const dfproto::ListUnitsIn &in, dfproto::ListUnitsOut &out) {
+			bench::make_units(out, in, unit_count);
+			return DFHack::CommandResult::Ok;
+		});
+	auto port = server_thread.listen();
+	if (port == 0)
+		return -1;
+
+	bench::ClientThread client_thread;
+	DFHack::Client &client = client_thread.client;
+	if (!bench::sync(client.connect("localhost", port))) {
+		qCritical() << "Failed to connect to mock server";
+		return -1;
+	}
+
+	const DFHack::Function<dfproto::EmptyMessage, dfproto::StringMessage> mock_payload = {"", "MockPayload"};
+	if (!bench::sync(mock_payload.bind(client))) {
+		qCritical() << "Failed to bind MockPayload";
+		return -1;
+	}
+
+	// Peak heap includes the reply message itself and the socket buffer
+	// holding its single string field (each about the size of the reply)
+	for (std::size_t mib: {1, 8, 32}) {
+		server_thread.server.setOptions({.reply_size = mib*1024*1024});
+		auto result = bench::measure(iterations, [&]() {
+			auto reply = bench::sync(mock_payload(client).first);
+			if (!reply || reply->value().size() != mib*1024*1024)
+				qFatal("Large call failed");
+		});
+		bench::report("large reply", "reply=" + std::to_string(mib) + "MiB", result);
+	}
+
+	// Replies made of many fields are parsed as they are received, the
+	// socket only buffers the unit being received.
+	DFHack::Basic basic;
+	dfproto::ListUnitsIn in;
+	in.mutable_mask()->set_labors(true);
+	in.mutable_mask()->set_skills(true);
+	for (int count: {10000, 100000}) {
+		unit_count = count;
+		auto result = bench::measure(iterations, [&]() {
+			auto reply = bench::sync(basic.listUnits(client, in).first);
+			if (!reply || reply->value_size() != count)
+				qFatal("ListUnits failed");
+		});
+		bench::report("large unit list", "units=" + std::to_string(count), result);
+	}
+
+	client.disconnect().waitForFinished();
+	return 0;
+}
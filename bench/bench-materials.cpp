@@ -0,0 +1,122 @@
+/*
+ * Copyright 2023 Clement Vuchener
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <QCoreApplication>
+
+#include <dfhack-client-qt/MaterialCache.h>
+
+#include "BenchUtils.h"
+#include "MockData.h"
+#include "MockServer.h"
+
+#include <QtDebug>
+
+static constexpr int LookupCount = 300;
+
+int main(int argc, char *argv[])
+{
+	QCoreApplication app(argc, argv);
+	int iterations = bench::iterations_from_args(argc, argv, 50);
+
+	MockServerThread server_thread;
+	server_thread.run([]() { bench::count_allocations(false); });
+	std::atomic<int> calls = 0;
+	server_thread.server.addMethod<dfproto::ListMaterialsIn, dfproto::ListMaterialsOut>("", "ListMaterials",
+		[&calls](const dfproto::ListMaterialsIn &in, dfproto::ListMaterialsOut &out) {
+			++calls;
+			bench::make_materials(out, in);
+			return DFHack::CommandResult::Ok;
+		});
+	auto port = server_thread.listen();
+	if (port == 0)
+		return -1;
+
+	bench::ClientThread client_thread;
+	DFHack::Client &client = client_thread.client;
+	if (!bench::sync(client.connect("localhost", port))) {
+		qCritical() << "Failed to connect to mock server";
+		return -1;
+	}
+
+	// Materials a tool typically needs: a few hundred scattered ids
+	std::vector<std::pair<int, int>> ids;
+	for (int i = 0; i < LookupCount; ++i) {
+		switch (i % 3) {
+		case 0: ids.emplace_back(0, i * 7 % bench::InorganicCount); break;
+		case 1: ids.emplace_back(19 + i % bench::CreatureMaterialCount, i * 11 % bench::CreatureCount); break;
+		case 2: ids.emplace_back(419 + i % bench::PlantMaterialCount, i * 13 % bench::PlantCount); break;
+		}
+	}
+
+	DFHack::Basic basic;
+	dfproto::ListMaterialsIn all;
+	all.set_builtin(true);
+	all.set_inorganic(true);
+	all.set_creatures(true);
+	all.set_plants(true);
+	auto full = bench::measure(iterations, [&]() {
+		auto reply = bench::sync(basic.listMaterials(client, all).first);
+		if (!reply)
+			qFatal("ListMaterials failed");
+	});
+	bench::report("startup", "full catalogue", full);
+
+	calls = 0;
+	auto single = bench::measure(iterations, [&]() {
+		for (auto [type, index]: ids) {
+			dfproto::ListMaterialsIn in;
+			auto id = in.add_id_list();
+			id->set_type(type);
+			id->set_index(index);
+			auto reply = bench::sync(basic.listMaterials(client, in).first);
+			if (!reply || reply->value_size() != 1)
+				qFatal("ListMaterials failed");
+		}
+	});
+	bench::report("startup", "lookups=300 one call each", single);
+
+	DFHack::MaterialCache cache(client);
+	cache.moveToThread(&client_thread.thread);
+	// Request all materials from the cache thread, in a single event loop turn
+	auto lookup_all = [&]() {
+		QList<QFuture<DFHack::MaterialCache::MaterialPtr>> futures;
+		QMetaObject::invokeMethod(&cache, [&]() {
+			for (auto [type, index]: ids)
+				futures.append(cache.get(type, index));
+		}, Qt::BlockingQueuedConnection);
+		for (auto &future: futures)
+			if (!bench::sync(std::move(future)))
+				qFatal("MaterialCache lookup failed");
+	};
+	calls = 0;
+	int measured_calls = 0;
+	auto cold = bench::measure(iterations, [&]() {
+		cache.clear();
+		int before = calls;
+		lookup_all();
+		measured_calls = calls - before;
+	});
+	bench::report("startup", "lookups=300 MaterialCache cold", cold);
+	qInfo().noquote() << QString("MaterialCache: %1 ListMaterials call(s) per cold lookup").arg(measured_calls);
+
+	auto warm = bench::measure(iterations, lookup_all);
+	bench::report("lookup", "lookups=300 MaterialCache warm", warm);
+
+	client.disconnect().waitForFinished();
+	return 0;
+}
@@ -0,0 +1,107 @@
+/*
+ * Copyright 2023 Clement Vuchener
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <QCoreApplication>
+#include <QDir>
+#include <QFile>
+
+#include <dfhack-client-qt/Client.h>
+#include <dfhack-client-qt/Function.h>
+#include <dfhack-client-qt/Metrics.h>
+
+#include "BenchUtils.h"
+#include "MockServer.h"
+
+#include <QtDebug>
+
+#include <cstdio>
+
+using namespace std::literals;
+
+static constexpr int CallsPerRefresh = 20;
+
+int main(int argc, char *argv[])
+{
+	QCoreApplication app(argc, argv);
+	int iterations = bench::iterations_from_args(argc, argv, 500);
+
+	MockServerThread server_thread;
+	auto &server = server_thread.server;
+	server_thread.run([]() {
+		bench::count_allocations(false);
+	});
+	auto port = server_thread.listen();
+	if (port == 0)
+		return -1;
+
+	bench::ClientThread client_thread;
+	DFHack::Client &client = client_thread.client;
+	if (!bench::sync(client.connect("localhost", port))) {
+		qCritical() << "Failed to connect to mock server";
+		return -1;
+	}
+
+	const DFHack::Function<dfproto::EmptyMessage, dfproto::StringMessage> mock_payload = {"", "MockPayload"};
+	if (!bench::sync(mock_payload.bind(client))) {
+		qCritical() << "Failed to bind mock methods";
+		return -1;
+	}
+
+	// No latency, so that the client overhead is not hidden by the
+	// round trips.
+	server.setOptions({.reply_size = 64, .notification_frames = 1});
+	client.setPipelineDepth(CallsPerRefresh);
+	for (bool enabled: {false, true, false, true}) {
+		client.setMetricsEnabled(enabled);
+		auto result = bench::measure(iterations, [&]() {
+			std::vector<QFuture<DFHack::CallReply<dfproto::StringMessage>>> replies;
+			replies.reserve(CallsPerRefresh);
+			for (int i = 0; i < CallsPerRefresh; ++i)
+				replies.push_back(mock_payload(client).first);
+			for (auto &reply: replies)
+				if (!bench::sync(std::move(reply)))
+					qFatal("Call failed");
+		});
+		bench::report("20-call refresh", enabled ? "metrics=on" : "metrics=off", result);
+	}
+
+	auto metrics = client.metrics();
+	const auto &method = metrics.methods[{"", "MockPayload"}];
+	auto expected = (iterations + iterations / 10) * CallsPerRefresh * 2;
+	if (method.count(DFHack::CommandResult::Ok) != std::uint64_t(expected))
+		qFatal("Expected %d calls in metrics, got %llu", expected,
+			static_cast<unsigned long long>(method.count(DFHack::CommandResult::Ok)));
+	if (method.wire_time.count() != std::uint64_t(expected) || method.notification_bytes == 0)
+		qFatal("Missing metrics");
+	std::printf("MockPayload wire time p50 %.1f us p99 %.1f us, queue wait p50 %.1f us p99 %.1f us\n",
+		std::chrono::duration<double, std::micro>(method.wire_time.percentile(0.5)).count(),
+		std::chrono::duration<double, std::micro>(method.wire_time.percentile(0.99)).count(),
+		std::chrono::duration<double, std::micro>(method.queue_wait.percentile(0.5)).count(),
+		std::chrono::duration<double, std::micro>(method.queue_wait.percentile(0.99)).count());
+
+	auto filename = QDir::temp().filePath("dfhack-client-qt-bench-metrics.prom");
+	auto result = bench::measure(10, [&]() {
+		if (!client.metrics().savePrometheus(filename))
+			qFatal("Failed to save metrics");
+	});
+	bench::report("metrics dump", "prometheus", result);
+	QFile::remove(filename);
+
+	client.disconnect().waitForFinished();
+	return 0;
+}
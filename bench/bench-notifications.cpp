@@ -0,0 +1,101 @@
+/*
+ * Copyright 2023 Clement Vuchener
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <QCoreApplication>
+
+#include <dfhack-client-qt/Client.h>
+#include <dfhack-client-qt/Function.h>
+
+#include "BenchUtils.h"
+#include "MockServer.h"
+
+#include <QtDebug>
+
+static constexpr int FrameCount = 100;
+static constexpr int FragmentsPerFrame = 1000;
+static constexpr int FragmentCount = FrameCount * FragmentsPerFrame;
+
+int main(int argc, char *argv[])
+{
+	QCoreApplication app(argc, argv);
+	int iterations = bench::iterations_from_args(argc, argv, 20);
+
+	MockServerThread server_thread;
+	server_thread.run([]() { bench::count_allocations(false); });
+	server_thread.server.setOptions({
+		.reply_size = 16,
+		.notification_frames = FrameCount,
+		.fragments_per_frame = FragmentsPerFrame,
+		.fragment_size = 40,
+	});
+	auto port = server_thread.listen();
+	if (port == 0)
+		return -1;
+
+	bench::ClientThread client_thread;
+	DFHack::Client &client = client_thread.client;
+	if (!bench::sync(client.connect("localhost", port))) {
+		qCritical() << "Failed to connect to mock server";
+		return -1;
+	}
+
+	// Notifications are received by an object in another thread, like a
+	// console widget in the GUI thread.
+	QThread receiver_thread;
+	QObject receiver;
+	receiver.moveToThread(&receiver_thread);
+	receiver_thread.start();
+	std::atomic<int> received = 0;
+	std::size_t text_length = 0; // only used in receiver thread
+	QObject::connect(&client, &DFHack::Client::notification, &receiver,
+		[&](DFHack::Color, const QString &text) {
+			text_length += text.size();
+			++received;
+		});
+	QObject::connect(&client, &DFHack::Client::notificationsBatch, &receiver,
+		[&](const DFHack::NotificationBatch &batch) {
+			for (std::size_t i = 0; i < batch.size(); ++i)
+				text_length += batch.text(i).size();
+			received += batch.size();
+		});
+
+	const DFHack::Function<dfproto::EmptyMessage, dfproto::StringMessage> mock_payload = {"", "MockPayload"};
+	auto run = [&]() {
+		received = 0;
+		auto [reply, notifications] = mock_payload(client);
+		if (!bench::sync(std::move(reply)))
+			qFatal("MockPayload failed");
+		notifications.waitForFinished();
+		if (notifications.resultCount() != FragmentCount)
+			qFatal("Expected %d notifications, got %d", FragmentCount, notifications.resultCount());
+		while (received != FragmentCount)
+			QThread::yieldCurrentThread();
+	};
+
+	auto single = bench::measure(iterations, run);
+	bench::report("RunCommand output", "fragments=100000 one by one", single);
+
+	client.setNotificationBatching(true);
+	auto batched = bench::measure(iterations, run);
+	bench::report("RunCommand output", "fragments=100000 batched", batched);
+
+	receiver_thread.quit();
+	receiver_thread.wait();
+	client.disconnect().waitForFinished();
+	return 0;
+}
@@ -0,0 +1,99 @@
+/*
+ * Copyright 2023 Clement Vuchener
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <QCoreApplication>
+
+#include <dfhack-client-qt/Client.h>
+#include <dfhack-client-qt/Function.h>
+#include <dfhack-client-qt/NotificationSink.h>
+
+#include "BenchUtils.h"
+#include "MockServer.h"
+
+#include <QtDebug>
+
+static constexpr int FrameCount = 100;
+static constexpr int FragmentsPerFrame = 1000;
+static constexpr std::size_t FragmentSize = 40;
+static constexpr std::size_t TailSize = 64*1024;
+
+int main(int argc, char *argv[])
+{
+	QCoreApplication app(argc, argv);
+	int iterations = bench::iterations_from_args(argc, argv, 20);
+
+	MockServerThread server_thread;
+	server_thread.run([]() { bench::count_allocations(false); });
+	server_thread.server.setOptions({
+		.reply_size = 16,
+		.notification_frames = FrameCount,
+		.fragments_per_frame = FragmentsPerFrame,
+		.fragment_size = FragmentSize,
+	});
+	auto port = server_thread.listen();
+	if (port == 0)
+		return -1;
+
+	bench::ClientThread client_thread;
+	DFHack::Client &client = client_thread.client;
+	if (!bench::sync(client.connect("localhost", port))) {
+		qCritical() << "Failed to connect to mock server";
+		return -1;
+	}
+
+	// A command printing 4 MB of text, the caller only wants the end of it
+	const DFHack::Function<dfproto::EmptyMessage, dfproto::StringMessage> mock_payload = {"", "MockPayload"};
+	auto future = bench::measure(iterations, [&]() {
+		auto [reply, notifications] = mock_payload(client);
+		if (!bench::sync(std::move(reply)))
+			qFatal("MockPayload failed");
+		notifications.waitForFinished();
+		std::size_t length = 0;
+		for (int i = std::max(0, notifications.resultCount() - int(TailSize / FragmentSize)); i < notifications.resultCount(); ++i)
+			length += notifications.resultAt(i).second.size();
+		if (length == 0)
+			qFatal("Missing notifications");
+	});
+	bench::report("RunCommand output", "4MB tail from future", future);
+
+	auto tail = std::make_shared<DFHack::RingBufferSink>(TailSize);
+	auto sink = bench::measure(iterations, [&]() {
+		tail->clear();
+		auto [reply, notifications] = mock_payload(client, {}, {
+			.notification_sink = tail,
+			.keep_notifications = false,
+		});
+		if (!bench::sync(std::move(reply)))
+			qFatal("MockPayload failed");
+		if (tail->contents().size() != TailSize)
+			qFatal("Missing notifications");
+	});
+	bench::report("RunCommand output", "4MB tail from RingBufferSink", sink);
+
+	DFHack::CallOptions no_notifications;
+	no_notifications.keep_notifications = false;
+	auto discard = bench::measure(iterations, [&]() {
+		auto [reply, notifications] = mock_payload(client, {}, no_notifications);
+		if (!bench::sync(std::move(reply)))
+			qFatal("MockPayload failed");
+	});
+	bench::report("RunCommand output", "4MB discarded", discard);
+
+	client.disconnect().waitForFinished();
+	return 0;
+}
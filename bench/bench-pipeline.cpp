@@ -0,0 +1,115 @@
+/*
+ * Copyright 2023 Clement Vuchener
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <QCoreApplication>
+
+#include <dfhack-client-qt/Client.h>
+#include <dfhack-client-qt/Function.h>
+
+#include "BenchUtils.h"
+#include "MockServer.h"
+
+#include <QtDebug>
+
+using namespace std::literals;
+
+static constexpr int CallsPerRefresh = 20;
+
+int main(int argc, char *argv[])
+{
+	QCoreApplication app(argc, argv);
+	int iterations = bench::iterations_from_args(argc, argv, 50);
+
+	MockServerThread server_thread;
+	auto &server = server_thread.server;
+	server_thread.run([&server]() {
+		bench::count_allocations(false);
+		// Echo the value, but fail for multiples of 3
+		server.addMethod<dfproto::IntMessage, dfproto::IntMessage>("", "MockEcho",
+			[](const dfproto::IntMessage &in, dfproto::IntMessage &out) {
+				if (in.value() % 3 == 0)
+					return DFHack::CommandResult::Failure;
+				out.set_value(in.value());
+				return DFHack::CommandResult::Ok;
+			});
+	});
+	auto port = server_thread.listen();
+	if (port == 0)
+		return -1;
+
+	bench::ClientThread client_thread;
+	DFHack::Client &client = client_thread.client;
+	if (!bench::sync(client.connect("localhost", port))) {
+		qCritical() << "Failed to connect to mock server";
+		return -1;
+	}
+
+	const DFHack::Function<dfproto::EmptyMessage, dfproto::StringMessage> mock_payload = {"", "MockPayload"};
+	const DFHack::Function<dfproto::IntMessage, dfproto::IntMessage> mock_echo = {"", "MockEcho"};
+	if (!bench::sync(mock_payload.bind(client)) || !bench::sync(mock_echo.bind(client))) {
+		qCritical() << "Failed to bind mock methods";
+		return -1;
+	}
+
+	// Check replies, text notifications and failures are matched to the
+	// right calls when pipelined.
+	server.setOptions({.notification_frames = 2});
+	client.setPipelineDepth(CallsPerRefresh);
+	{
+		std::vector<std::pair<
+			QFuture<DFHack::CallReply<dfproto::IntMessage>>,
+			QFuture<DFHack::TextNotification>>> calls;
+		for (int i = 0; i < CallsPerRefresh; ++i) {
+			auto in = mock_echo.args();
+			in.set_value(i);
+			calls.push_back(mock_echo(client, in));
+		}
+		for (int i = 0; i < CallsPerRefresh; ++i) {
+			auto &[reply, notifications] = calls[i];
+			auto r = bench::sync(std::move(reply));
+			if (i % 3 == 0 ? r.cr != DFHack::CommandResult::Failure : !r || r->value() != i)
+				qFatal("Pipelined call %d got a wrong reply", i);
+			notifications.waitForFinished();
+			if (notifications.resultCount() != 2)
+				qFatal("Pipelined call %d got %d notifications", i, notifications.resultCount());
+		}
+	}
+
+	for (auto latency: {1ms, 5ms}) {
+		server.setOptions({.latency = latency, .reply_size = 64});
+		for (int depth: {1, 4, CallsPerRefresh}) {
+			client.setPipelineDepth(depth);
+			auto result = bench::measure(iterations, [&]() {
+				std::vector<QFuture<DFHack::CallReply<dfproto::StringMessage>>> replies;
+				replies.reserve(CallsPerRefresh);
+				for (int i = 0; i < CallsPerRefresh; ++i)
+					replies.push_back(mock_payload(client).first);
+				for (auto &reply: replies)
+					if (!bench::sync(std::move(reply)))
+						qFatal("Pipelined call failed");
+			});
+			bench::report("20-call refresh",
+				"depth=" + std::to_string(depth)
+				+ " latency=" + std::to_string(latency.count()) + "ms",
+				result);
+		}
+	}
+
+	client.disconnect().waitForFinished();
+	return 0;
+}
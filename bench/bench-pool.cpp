@@ -0,0 +1,71 @@
+/*
+ * Copyright 2023 Clement Vuchener
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <QCoreApplication>
+
+#include <dfhack-client-qt/ClientPool.h>
+#include <dfhack-client-qt/Function.h>
+
+#include "BenchUtils.h"
+#include "MockServer.h"
+
+#include <QtDebug>
+
+using namespace std::literals;
+
+static constexpr int CallsPerBatch = 16;
+
+int main(int argc, char *argv[])
+{
+	QCoreApplication app(argc, argv);
+	int iterations = bench::iterations_from_args(argc, argv, 50);
+
+	MockServerThread server_thread;
+	server_thread.run([]() { bench::count_allocations(false); });
+	auto port = server_thread.listen();
+	if (port == 0)
+		return -1;
+	// Each call keeps its connection busy for 1ms
+	server_thread.server.setOptions({.processing_time = 1ms, .reply_size = 1024});
+
+	const DFHack::Function<dfproto::EmptyMessage, dfproto::StringMessage> mock_payload = {"", "MockPayload"};
+
+	for (int size: {1, 2, 4, 8}) {
+		DFHack::ClientPool pool(size);
+		if (!bench::sync(pool.connect("localhost", port))) {
+			qCritical() << "Failed to connect to mock server";
+			return -1;
+		}
+		if (!bench::sync(pool.bind(mock_payload))) {
+			qCritical() << "Failed to bind MockPayload";
+			return -1;
+		}
+		auto result = bench::measure(iterations, [&]() {
+			std::vector<QFuture<DFHack::CallReply<dfproto::StringMessage>>> replies;
+			replies.reserve(CallsPerBatch);
+			for (int i = 0; i < CallsPerBatch; ++i)
+				replies.push_back(pool.call(mock_payload).first);
+			for (auto &reply: replies)
+				if (!bench::sync(std::move(reply)))
+					qFatal("Pool call failed");
+		});
+		bench::report("16-call batch", "pool=" + std::to_string(size) + " processing=1ms", result);
+		pool.disconnect().waitForFinished();
+	}
+	return 0;
+}
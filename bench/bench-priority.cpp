@@ -0,0 +1,131 @@
+/*
+ * Copyright 2023 Clement Vuchener
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <QCoreApplication>
+
+#include <dfhack-client-qt/Client.h>
+#include <dfhack-client-qt/Function.h>
+
+#include "BenchUtils.h"
+#include "MockServer.h"
+
+#include <QtDebug>
+
+#include <cstdio>
+
+using namespace std::literals;
+
+static constexpr int BulkCalls = 20;
+
+static void report_stats(DFHack::Client &client, const char *params)
+{
+	using Priority = DFHack::CallOptions::Priority;
+	using us = std::chrono::duration<double, std::micro>;
+	for (auto [priority, name]: {
+			std::pair{Priority::Interactive, "interactive"},
+			std::pair{Priority::Normal, "normal"},
+			std::pair{Priority::Bulk, "bulk"}}) {
+		auto stats = client.queueStats(priority);
+		if (stats.sent == 0)
+			continue;
+		std::printf("%-24s %-36s %10llu sent  mean wait %9.1f us  max wait %9.1f us\n",
+			(std::string("queue ") + name).c_str(), params,
+			static_cast<unsigned long long>(stats.sent),
+			us(stats.meanWait()).count(),
+			us(stats.max_wait).count());
+	}
+	std::fflush(stdout);
+}
+
+int main(int argc, char *argv[])
+{
+	QCoreApplication app(argc, argv);
+	int iterations = bench::iterations_from_args(argc, argv, 50);
+
+	MockServerThread server_thread;
+	auto &server = server_thread.server;
+	server_thread.run([]() {
+		bench::count_allocations(false);
+	});
+	auto port = server_thread.listen();
+	if (port == 0)
+		return -1;
+
+	bench::ClientThread client_thread;
+	DFHack::Client &client = client_thread.client;
+	if (!bench::sync(client.connect("localhost", port))) {
+		qCritical() << "Failed to connect to mock server";
+		return -1;
+	}
+
+	const DFHack::Function<dfproto::EmptyMessage, dfproto::StringMessage> mock_payload = {"", "MockPayload"};
+	if (!bench::sync(mock_payload.bind(client))) {
+		qCritical() << "Failed to bind mock methods";
+		return -1;
+	}
+
+	// A background scan of BulkCalls calls is queued just before a user
+	// action, measure the latency of the user action.
+	server.setOptions({.processing_time = 1ms, .reply_size = 1024});
+	for (bool priorities: {false, true}) {
+		DFHack::CallOptions bulk, interactive;
+		if (priorities) {
+			bulk.priority = DFHack::CallOptions::Priority::Bulk;
+			interactive.priority = DFHack::CallOptions::Priority::Interactive;
+		}
+		const char *params = priorities ? "priorities" : "fifo";
+		client.resetQueueStats();
+		bench::Result result{};
+		for (int i = 0; i < iterations; ++i) {
+			std::vector<QFuture<DFHack::CallReply<dfproto::StringMessage>>> scan;
+			for (int j = 0; j < BulkCalls; ++j)
+				scan.push_back(mock_payload(client, {}, bulk).first);
+			auto t0 = std::chrono::steady_clock::now();
+			if (!bench::sync(mock_payload(client, {}, interactive).first))
+				qFatal("Interactive call failed");
+			result.samples.push_back(std::chrono::steady_clock::now() - t0);
+			result.total += result.samples.back();
+			for (auto &reply: scan)
+				if (!bench::sync(std::move(reply)))
+					qFatal("Bulk call failed");
+		}
+		bench::report("click behind scan", params, result);
+		report_stats(client, params);
+	}
+
+	// Bulk calls still progress under constant interactive load
+	for (int share: {0, 4}) {
+		client.setBulkShare(share);
+		client.resetQueueStats();
+		DFHack::CallOptions bulk, interactive;
+		bulk.priority = DFHack::CallOptions::Priority::Bulk;
+		interactive.priority = DFHack::CallOptions::Priority::Interactive;
+		std::vector<QFuture<DFHack::CallReply<dfproto::StringMessage>>> calls;
+		for (int j = 0; j < BulkCalls; ++j)
+			calls.push_back(mock_payload(client, {}, bulk).first);
+		for (int j = 0; j < 4 * BulkCalls; ++j)
+			calls.push_back(mock_payload(client, {}, interactive).first);
+		for (auto &reply: calls)
+			if (!bench::sync(std::move(reply)))
+				qFatal("Call failed");
+		report_stats(client, ("bulk share=" + std::to_string(share)).c_str());
+	}
+
+	client.disconnect().waitForFinished();
+	return 0;
+}
@@ -0,0 +1,90 @@
+/*
+ * Copyright 2023 Clement Vuchener
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <QCoreApplication>
+
+#include <dfhack-client-qt/Basic.h>
+#include <dfhack-client-qt/MessagePool.h>
+
+#include "BenchUtils.h"
+#include "MockData.h"
+#include "MockServer.h"
+
+#include <QtDebug>
+
+static constexpr int UnitCount = 1000;
+
+int main(int argc, char *argv[])
+{
+	QCoreApplication app(argc, argv);
+	int iterations = bench::iterations_from_args(argc, argv, 200);
+
+	MockServerThread server_thread;
+	server_thread.run([]() { bench::count_allocations(false); });
+	server_thread.server.addMethod<dfproto::ListUnitsIn, dfproto::ListUnitsOut>("", "ListUnits",
+		[](const dfproto::ListUnitsIn &in, dfproto::ListUnitsOut &out) {
+			bench::make_units(out, in, UnitCount);
+			return DFHack::CommandResult::Ok;
+		});
+	auto port = server_thread.listen();
+	if (port == 0)
+		return -1;
+
+	bench::ClientThread client_thread;
+	DFHack::Client &client = client_thread.client;
+	if (!bench::sync(client.connect("localhost", port))) {
+		qCritical() << "Failed to connect to mock server";
+		return -1;
+	}
+	DFHack::Basic basic;
+	if (!bench::sync(basic.listUnits.bind(client))) {
+		qCritical() << "Failed to bind ListUnits";
+		return -1;
+	}
+
+	dfproto::ListUnitsIn in;
+	in.mutable_mask()->set_labors(true);
+	in.mutable_mask()->set_skills(true);
+
+	// Every reply is released before the next call, as a polling loop does
+	auto fresh = bench::measure(iterations, [&]() {
+		auto reply = bench::sync(basic.listUnits(client, in).first);
+		if (!reply || reply->value_size() != UnitCount)
+			qFatal("ListUnits failed");
+	});
+	bench::report("poll listUnits", "units=1000 make_shared", fresh);
+
+	DFHack::MessagePool<dfproto::ListUnitsOut> pool(2);
+	auto recycled = bench::measure(iterations, [&]() {
+		auto reply = bench::sync(basic.listUnits(client, pool, in).first);
+		if (!reply || reply->value_size() != UnitCount)
+			qFatal("ListUnits failed");
+	});
+	bench::report("poll listUnits", "units=1000 pool", recycled);
+
+	// What is left is the per-call cost of the futures and the request
+	auto empty = bench::measure(iterations, [&]() {
+		auto reply = bench::sync(basic.getVersion(client).first);
+		if (!reply)
+			qFatal("GetVersion failed");
+	});
+	bench::report("poll getVersion", "baseline", empty);
+
+	client.disconnect().waitForFinished();
+	return 0;
+}
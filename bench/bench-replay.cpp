@@ -0,0 +1,117 @@
+/*
+ * Copyright 2023 Clement Vuchener
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <QCoreApplication>
+#include <QDir>
+#include <QFile>
+
+#include <dfhack-client-qt/Basic.h>
+#include <dfhack-client-qt/Capture.h>
+
+#include "BenchUtils.h"
+#include "MockData.h"
+#include "MockServer.h"
+#include "ReplayServer.h"
+
+#include <QtDebug>
+
+using namespace std::literals;
+
+static constexpr int UnitCount = 250;
+static constexpr int CallsPerSession = 10;
+
+// Connect, list units a few times and disconnect
+static void session(DFHack::Client &client, quint16 port, const dfproto::ListUnitsIn &in)
+{
+	if (!bench::sync(client.connect("localhost", port)))
+		qFatal("Failed to connect");
+	DFHack::Basic basic;
+	for (int i = 0; i < CallsPerSession; ++i) {
+		auto reply = bench::sync(basic.listUnits(client, in).first);
+		if (!reply || reply->value_size() != UnitCount)
+			qFatal("ListUnits failed");
+	}
+	client.disconnect().waitForFinished();
+}
+
+int main(int argc, char *argv[])
+{
+	QCoreApplication app(argc, argv);
+	int iterations = bench::iterations_from_args(argc, argv, 20);
+
+	MockServerThread server_thread;
+	server_thread.run([]() { bench::count_allocations(false); });
+	server_thread.server.addMethod<dfproto::ListUnitsIn, dfproto::ListUnitsOut>("", "ListUnits",
+		[](const dfproto::ListUnitsIn &in, dfproto::ListUnitsOut &out) {
+			bench::make_units(out, in, UnitCount);
+			return DFHack::CommandResult::Ok;
+		});
+	auto port = server_thread.listen();
+	if (port == 0)
+		return -1;
+	server_thread.server.setOptions({.latency = 1ms});
+
+	bench::ClientThread client_thread;
+	DFHack::Client &client = client_thread.client;
+
+	dfproto::ListUnitsIn in;
+	in.mutable_mask()->set_labors(true);
+	in.mutable_mask()->set_skills(true);
+
+	// Record one session
+	auto filename = QDir::temp().filePath("dfhack-client-qt-bench-replay.cap");
+	auto capture = std::make_shared<DFHack::CaptureWriter>();
+	if (!capture->open(filename)) {
+		qCritical() << "Failed to open capture file" << filename;
+		return -1;
+	}
+	client.setCapture(capture);
+	session(client, port, in);
+	client.setCapture(nullptr);
+	if (!capture->close()) {
+		qCritical() << "Failed to write capture file" << filename;
+		return -1;
+	}
+
+	auto live = bench::measure(iterations, [&]() { session(client, port, in); });
+	bench::report("session", "mock server", live);
+
+	ReplayServerThread replay_thread;
+	bool loaded = false;
+	replay_thread.run([&]() { loaded = replay_thread.server.load(filename); });
+	QFile::remove(filename);
+	if (!loaded) {
+		qCritical() << "Failed to load capture";
+		return -1;
+	}
+	auto replay_port = replay_thread.listen();
+	if (replay_port == 0)
+		return -1;
+	for (double speed: {1.0, 0.0}) {
+		replay_thread.run([&]() { replay_thread.server.setSpeed(speed); });
+		auto result = bench::measure(iterations, [&]() { session(client, replay_port, in); });
+		bench::report("session", speed > 0 ? "replay speed=1" : "replay speed=0", result);
+	}
+	quint64 mismatched = 0;
+	replay_thread.run([&]() { mismatched = replay_thread.server.mismatchedBytes(); });
+	if (mismatched != 0)
+		qFatal("Replayed session sent %llu unexpected bytes",
+			static_cast<unsigned long long>(mismatched));
+
+	return 0;
+}
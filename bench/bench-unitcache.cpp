@@ -0,0 +1,109 @@
+/*
+ * Copyright 2023 Clement Vuchener
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <QCoreApplication>
+
+#include <dfhack-client-qt/UnitCache.h>
+
+#include "BenchUtils.h"
+#include "MockData.h"
+#include "MockServer.h"
+
+#include <unordered_map>
+
+#include <QtDebug>
+
+static constexpr int UnitCount = 250;
+static constexpr int ConsumerCount = 3;
+
+int main(int argc, char *argv[])
+{
+	QCoreApplication app(argc, argv);
+	int iterations = bench::iterations_from_args(argc, argv, 200);
+
+	MockServerThread server_thread;
+	server_thread.run([]() { bench::count_allocations(false); });
+	std::atomic<int> tick = 0;
+	server_thread.server.addMethod<dfproto::ListUnitsIn, dfproto::ListUnitsOut>("", "ListUnits",
+		[&tick](const dfproto::ListUnitsIn &in, dfproto::ListUnitsOut &out) {
+			bench::make_units(out, in, UnitCount, tick++);
+			return DFHack::CommandResult::Ok;
+		});
+	auto port = server_thread.listen();
+	if (port == 0)
+		return -1;
+
+	bench::ClientThread client_thread;
+	DFHack::Client &client = client_thread.client;
+	if (!bench::sync(client.connect("localhost", port))) {
+		qCritical() << "Failed to connect to mock server";
+		return -1;
+	}
+
+	dfproto::ListUnitsIn in;
+	in.mutable_mask()->set_labors(true);
+	in.mutable_mask()->set_skills(true);
+	in.mutable_mask()->set_profession(true);
+	in.mutable_mask()->set_misc_traits(true);
+
+	// Each consumer keeps its own copy and diffs the whole list
+	DFHack::Basic basic;
+	std::vector<std::unordered_map<int, dfproto::BasicUnitInfo>> consumers(ConsumerCount);
+	auto full = bench::measure(iterations, [&]() {
+		auto reply = bench::sync(basic.listUnits(client, in).first);
+		if (!reply)
+			qFatal("ListUnits failed");
+		for (auto &units: consumers)
+			for (const auto &unit: reply->value()) {
+				auto &old = units[unit.unit_id()];
+				if (DFHack::UnitCache::compare(old, unit))
+					old.CopyFrom(unit);
+			}
+	});
+	bench::report("refresh", "units=250 consumers=3 full diff", full);
+
+	// Consumers only look at changed units
+	DFHack::UnitCache cache(client);
+	cache.setRequest(in);
+	cache.moveToThread(&client_thread.thread);
+	std::uint64_t changes = 0, refreshes = 0;
+	for (int i = 0; i < ConsumerCount; ++i) {
+		QObject::connect(&cache, &DFHack::UnitCache::unitsChanged, &cache,
+			[&cache, &changes](const QList<DFHack::UnitCache::Change> &changed) {
+				for (const auto &change: changed)
+					if (cache.unit(change.unit_id))
+						++changes;
+			});
+	}
+	QObject::connect(&cache, &DFHack::UnitCache::refreshed, &cache, [&refreshes]() {
+		++refreshes;
+	});
+	if (bench::sync(cache.refresh()) != DFHack::CommandResult::Ok || cache.size() != UnitCount)
+		qFatal("UnitCache refresh failed");
+	changes = refreshes = 0;
+	auto cached = bench::measure(iterations, [&]() {
+		if (bench::sync(cache.refresh()) != DFHack::CommandResult::Ok)
+			qFatal("UnitCache refresh failed");
+	});
+	bench::report("refresh", "units=250 consumers=3 UnitCache", cached);
+	qInfo().noquote() << QString("UnitCache: %1 changed units per refresh per consumer")
+		.arg(double(changes) / refreshes / ConsumerCount);
+
+	client.disconnect().waitForFinished();
+	return 0;
+}
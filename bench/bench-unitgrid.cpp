@@ -0,0 +1,104 @@
+/*
+ * Copyright 2023 Clement Vuchener
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <QCoreApplication>
+
+#include <dfhack-client-qt/UnitGrid.h>
+
+#include "BenchUtils.h"
+#include "MockData.h"
+
+#include <QtDebug>
+
+static constexpr int UnitCount = 2000;
+static constexpr int ThreatRadius = 10;
+static constexpr int TickCount = 16;
+
+static DFHack::UnitGrid::Position position(const dfproto::BasicUnitInfo &unit)
+{
+	return {unit.pos_x(), unit.pos_y(), unit.pos_z()};
+}
+
+int main(int argc, char *argv[])
+{
+	QCoreApplication app(argc, argv);
+	int iterations = bench::iterations_from_args(argc, argv, 200);
+
+	dfproto::ListUnitsIn in;
+	std::vector<dfproto::ListUnitsOut> ticks(TickCount);
+	for (int tick = 0; tick < TickCount; ++tick)
+		bench::make_units(ticks[tick], in, UnitCount, tick);
+	const auto &units = ticks[0];
+	// race 1 units are hostile
+	auto hostile = [](const dfproto::BasicUnitInfo &unit) { return unit.race() == 1; };
+
+	std::uint64_t naive_threats = 0;
+	auto naive = bench::measure(iterations, [&]() {
+		naive_threats = 0;
+		for (const auto &a: units.value()) {
+			if (!hostile(a))
+				continue;
+			for (const auto &b: units.value())
+				if (!hostile(b) && DFHack::UnitGrid::squaredDistance(position(a), position(b))
+						<= ThreatRadius * ThreatRadius)
+					++naive_threats;
+		}
+	});
+	bench::report("threats", "units=2000 radius=10 pairwise", naive);
+
+	DFHack::UnitGrid grid;
+	grid.update(units);
+	std::uint64_t grid_threats = 0;
+	std::vector<int> found;
+	auto indexed = bench::measure(iterations, [&]() {
+		grid_threats = 0;
+		for (const auto &a: units.value()) {
+			if (!hostile(a))
+				continue;
+			found.clear();
+			grid.withinRadius(position(a), ThreatRadius, found);
+			for (int unit_id: found)
+				if (!hostile(units.value(unit_id - bench::FirstUnitId)))
+					++grid_threats;
+		}
+	});
+	bench::report("threats", "units=2000 radius=10 UnitGrid", indexed);
+	if (grid_threats != naive_threats)
+		qFatal("UnitGrid found %llu threats instead of %llu",
+				(unsigned long long)grid_threats, (unsigned long long)naive_threats);
+
+	auto knn = bench::measure(iterations, [&]() {
+		for (const auto &a: units.value())
+			if (hostile(a))
+				grid.nearest(position(a), 5);
+	});
+	bench::report("nearest", "units=2000 k=5 UnitGrid", knn);
+
+	int tick = 0;
+	auto rebuild = bench::measure(iterations, [&]() {
+		grid.clear();
+		grid.update(ticks[++tick % TickCount]);
+	});
+	bench::report("update", "units=2000 rebuild", rebuild);
+	auto incremental = bench::measure(iterations, [&]() {
+		grid.update(ticks[++tick % TickCount]);
+	});
+	bench::report("update", "units=2000 incremental", incremental);
+
+	return 0;
+}
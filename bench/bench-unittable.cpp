@@ -0,0 +1,141 @@
+/*
+ * Copyright 2023 Clement Vuchener
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <QCoreApplication>
+
+#include <dfhack-client-qt/Basic.h>
+#include <dfhack-client-qt/UnitTable.h>
+
+#include "BenchUtils.h"
+#include "MockData.h"
+#include "MockServer.h"
+
+#include <QtDebug>
+
+static constexpr int UnitCount = 10000;
+
+// flags1: active (0x100) and not moving (0x10000), citizens of civ 1
+static constexpr std::uint32_t ActiveFlag = 0x00000100u;
+static constexpr std::uint32_t MoveFlag = 0x00010000u;
+static constexpr int CivId = 1;
+
+int main(int argc, char *argv[])
+{
+	QCoreApplication app(argc, argv);
+	int iterations = bench::iterations_from_args(argc, argv, 200);
+
+	dfproto::ListUnitsIn in;
+	in.mutable_mask()->set_labors(true);
+	in.mutable_mask()->set_skills(true);
+	in.mutable_mask()->set_profession(true);
+	dfproto::ListUnitsOut units;
+	bench::make_units(units, in, UnitCount);
+	auto data = units.SerializeAsString();
+
+	dfproto::ListUnitsOut message;
+	auto parse_message = bench::measure(iterations, [&]() {
+		if (!message.ParseFromString(data))
+			qFatal("Failed to parse ListUnitsOut");
+	});
+	bench::report("decode", "units=10000 protobuf", parse_message);
+
+	DFHack::UnitTable table;
+	auto parse_table = bench::measure(iterations, [&]() {
+		if (!table.parseFromString(data))
+			qFatal("Failed to decode UnitTable");
+	});
+	bench::report("decode", "units=10000 UnitTable", parse_table);
+	if (table.size() != UnitCount)
+		qFatal("UnitTable has %zu rows", table.size());
+
+	// Truncated replies must be rejected like protobuf does, prefixes
+	// ending between units are valid shorter lists.
+	dfproto::ListUnitsOut small;
+	bench::make_units(small, in, 3);
+	auto small_data = small.SerializeAsString();
+	dfproto::ListUnitsOut prefix_message;
+	DFHack::UnitTable prefix_table;
+	for (std::size_t size = 0; size < small_data.size(); ++size) {
+		auto prefix = small_data.substr(0, size);
+		bool expected = prefix_message.ParseFromString(prefix);
+		if (prefix_table.parseFromString(prefix) != expected)
+			qFatal("UnitTable %s a %zu byte prefix", expected ? "rejected" : "accepted", size);
+		if (prefix_table.size() != std::size_t(expected ? prefix_message.value_size() : 0))
+			qFatal("UnitTable has %zu rows for a %zu byte prefix", prefix_table.size(), size);
+	}
+
+	std::vector<std::uint32_t> rows;
+	auto query_message = bench::measure(iterations * 10, [&]() {
+		rows.clear();
+		for (int i = 0; i < message.value_size(); ++i) {
+			const auto &unit = message.value(i);
+			if ((unit.flags1() & ActiveFlag) && !(unit.flags1() & MoveFlag)
+					&& unit.civ_id() == CivId)
+				rows.push_back(i);
+		}
+	});
+	bench::report("query", "units=10000 protobuf", query_message);
+	auto expected = rows.size();
+
+	DFHack::UnitTable::Filter filter;
+	filter.flags_set[0] = ActiveFlag;
+	filter.flags_clear[0] = MoveFlag;
+	filter.civ_id = CivId;
+	auto query_table = bench::measure(iterations * 10, [&]() {
+		rows = table.select(filter);
+	});
+	bench::report("query", "units=10000 UnitTable", query_table);
+	if (rows.size() != expected)
+		qFatal("UnitTable selected %zu rows instead of %zu", rows.size(), expected);
+
+	MockServerThread server_thread;
+	server_thread.run([]() { bench::count_allocations(false); });
+	server_thread.server.addMethod<dfproto::ListUnitsIn, dfproto::ListUnitsOut>("", "ListUnits",
+		[](const dfproto::ListUnitsIn &in, dfproto::ListUnitsOut &out) {
+			bench::make_units(out, in, UnitCount);
+			return DFHack::CommandResult::Ok;
+		});
+	auto port = server_thread.listen();
+	if (port == 0)
+		return -1;
+
+	bench::ClientThread client_thread;
+	DFHack::Client &client = client_thread.client;
+	if (!bench::sync(client.connect("localhost", port))) {
+		qCritical() << "Failed to connect to mock server";
+		return -1;
+	}
+
+	DFHack::Basic basic;
+	auto call_message = bench::measure(iterations / 4, [&]() {
+		auto reply = bench::sync(basic.listUnits(client, in).first);
+		if (!reply)
+			qFatal("ListUnits failed");
+	});
+	bench::report("listUnits", "units=10000 protobuf", call_message);
+
+	auto shared_table = std::make_shared<DFHack::UnitTable>();
+	auto call_table = bench::measure(iterations / 4, [&]() {
+		if (bench::sync(basic.listUnits(client, shared_table, in).first) != DFHack::CommandResult::Ok)
+			qFatal("ListUnits failed");
+	});
+	bench::report("listUnits", "units=10000 UnitTable", call_table);
+
+	client.disconnect().waitForFinished();
+	return 0;
+}
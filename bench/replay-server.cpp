@@ -0,0 +1,56 @@
+/*
+ * Copyright 2023 Clement Vuchener
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <QCommandLineParser>
+#include <QCoreApplication>
+
+#include "ReplayServer.h"
+
+#include <QtDebug>
+
+#include <dfhack-client-qt/Client.h>
+
+int main(int argc, char *argv[])
+{
+	QCoreApplication app(argc, argv);
+
+	QCommandLineParser parser;
+	parser.setApplicationDescription("Replay a DFHack client capture as a server");
+	parser.addHelpOption();
+	parser.addPositionalArgument("capture", "Capture file recorded with Client::setCapture");
+	QCommandLineOption speed_option({"s", "speed"}, "Divide recorded delays by <speed>, 0 for no delay.", "speed", "1");
+	QCommandLineOption port_option({"p", "port"}, "Listen on <port>.", "port",
+			QString::number(DFHack::Client::DefaultPort));
+	parser.addOption(speed_option);
+	parser.addOption(port_option);
+	parser.process(app);
+	if (parser.positionalArguments().size() != 1)
+		parser.showHelp(1);
+
+	ReplayServer server;
+	if (!server.load(parser.positionalArguments().front())) {
+		qCritical() << "Failed to load capture" << parser.positionalArguments().front();
+		return 1;
+	}
+	server.setSpeed(parser.value(speed_option).toDouble());
+	auto port = server.listen(parser.value(port_option).toUShort());
+	if (port == 0)
+		return 1;
+	qInfo() << "Replaying" << server.connectionCount() << "connections on port" << port;
+	return app.exec();
+}
@@ -0,0 +1,99 @@
+/*
+ * Copyright 2023 Clement Vuchener
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "ConsoleBuffer.h"
+
+#include <algorithm>
+
+void ConsoleBuffer::Line::clear()
+{
+	// keep the capacity for the next line using this slot
+	text.resize(0);
+	spans.clear();
+	style = Style::Output;
+}
+
+ConsoleBuffer::ConsoleBuffer(std::size_t max_lines)
+	: lines(std::max<std::size_t>(max_lines, 1))
+{
+	pushLine(Style::Output);
+}
+
+void ConsoleBuffer::setMaxLines(std::size_t max_lines)
+{
+	max_lines = std::max<std::size_t>(max_lines, 1);
+	auto kept = std::min(count, max_lines);
+	std::vector<Line> new_lines(max_lines);
+	for (std::size_t i = 0; i < kept; ++i)
+		new_lines[i] = std::move(lines[(first + count - kept + i) % lines.size()]);
+	dropped_lines += count - kept;
+	lines = std::move(new_lines);
+	first = 0;
+	count = kept;
+}
+
+void ConsoleBuffer::append(DFHack::Color color, QStringView text)
+{
+	while (!text.isEmpty()) {
+		auto newline = text.indexOf(u'\n');
+		auto part = newline < 0 ? text : text.first(newline);
+		if (!part.isEmpty()) {
+			auto &line = last();
+			// Merge with the previous span if the color did not change
+			if (!line.spans.empty() && line.spans.back().color == color)
+				line.spans.back().length += part.size();
+			else
+				line.spans.push_back({color, int(line.text.size()), int(part.size())});
+			line.text.append(part);
+		}
+		if (newline < 0)
+			break;
+		pushLine(Style::Output);
+		text = text.sliced(newline + 1);
+	}
+}
+
+void ConsoleBuffer::newLine(Style style)
+{
+	auto &line = last();
+	if (line.text.isEmpty())
+		line.style = style;
+	else
+		pushLine(style);
+}
+
+void ConsoleBuffer::clear()
+{
+	dropped_lines += count;
+	first = 0;
+	count = 0;
+	pushLine(Style::Output);
+}
+
+void ConsoleBuffer::pushLine(Style style)
+{
+	if (count == lines.size()) {
+		first = (first + 1) % lines.size();
+		--count;
+		++dropped_lines;
+	}
+	++count;
+	auto &line = last();
+	line.clear();
+	line.style = style;
+}
@@ -0,0 +1,103 @@
+/*
+ * Copyright 2023 Clement Vuchener
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef CONSOLE_BUFFER_H
+#define CONSOLE_BUFFER_H
+
+#include <QString>
+#include <QStringView>
+
+#include <cstdint>
+#include <vector>
+
+#include <dfhack-client-qt/Client.h>
+
+/**
+ * Scrollback of the console: the last lines of output with their colors.
+ *
+ * Lines are kept in a ring buffer, appending is constant time and the
+ * oldest lines are dropped once the limit is reached.
+ */
+class ConsoleBuffer
+{
+public:
+	enum class Style
+	{
+		Output,
+		Command,
+	};
+
+	struct Span
+	{
+		DFHack::Color color;
+		int begin, length; // in line text
+	};
+
+	struct Line
+	{
+		QString text;
+		std::vector<Span> spans;
+		Style style = Style::Output;
+
+		void clear();
+	};
+
+	ConsoleBuffer(std::size_t max_lines = 10000);
+
+	/**
+	 * Change the scrollback limit, dropping the oldest lines if needed.
+	 */
+	void setMaxLines(std::size_t max_lines);
+	std::size_t maxLines() const { return lines.size(); }
+
+	/**
+	 * Append text to the last line, starting new lines for each '\n'.
+	 */
+	void append(DFHack::Color color, QStringView text);
+	/**
+	 * Start a new line with \p style, unless the last line is empty (then
+	 * only its style is changed).
+	 */
+	void newLine(Style style = Style::Output);
+
+	/**
+	 * Number of lines currently in the buffer.
+	 */
+	std::size_t size() const { return count; }
+	/**
+	 * Line \p i, 0 is the oldest line kept.
+	 */
+	const Line &line(std::size_t i) const { return lines[(first + i) % lines.size()]; }
+	/**
+	 * Total number of lines dropped since the buffer was created.
+	 */
+	std::uint64_t dropped() const { return dropped_lines; }
+
+	void clear();
+
+private:
+	Line &last() { return lines[(first + count - 1) % lines.size()]; }
+	void pushLine(Style style);
+
+	std::vector<Line> lines; // ring buffer, lines are reused when dropped
+	std::size_t first = 0;
+	std::size_t count = 0;
+	std::uint64_t dropped_lines = 0;
+};
+
+#endif
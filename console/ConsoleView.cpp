@@ -0,0 +1,220 @@
+/*
+ * Copyright 2023 Clement Vuchener
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "ConsoleView.h"
+
+#include <QFontDatabase>
+#include <QPainter>
+#include <QScrollBar>
+
+#include <algorithm>
+
+static QColor get_color_code(const QPalette &palette, DFHack::Color color)
+{
+	using DFHack::Color;
+	switch (color) {
+	case Color::Black:
+		return palette.color(QPalette::WindowText);
+	case Color::Blue:
+		return "#000080";
+	case Color::Green:
+		return "#008000";
+	case Color::Cyan:
+		return "#008080";
+	case Color::Red:
+		return "#800000";
+	case Color::Magenta:
+		return "#800080";
+	case Color::Brown:
+		return "#808000";
+	case Color::Grey:
+		return "#c0c0c0";
+	case Color::DarkGrey:
+		return "#808080";
+	case Color::LightBlue:
+		return "#0000ff";
+	case Color::LightGreen:
+		return "#00ff00";
+	case Color::LightCyan:
+		return "#00ffff";
+	case Color::LightRed:
+		return "#ff0000";
+	case Color::LightMagenta:
+		return "#ff00ff";
+	case Color::Yellow:
+		return "#ffff00";
+	case Color::White:
+		return palette.color(QPalette::Window);
+	default:
+		return "";
+	}
+}
+
+ConsoleView::ConsoleView(QWidget *parent)
+	: QAbstractScrollArea(parent)
+	, dropped_lines(buffer.dropped())
+{
+	setFont(QFontDatabase::systemFont(QFontDatabase::FixedFont));
+	setFocusPolicy(Qt::StrongFocus);
+	// Coalesce appends from the same frame
+	update_timer.setSingleShot(true);
+	update_timer.setInterval(16);
+	connect(&update_timer, &QTimer::timeout, this, &ConsoleView::updateView);
+	connect(horizontalScrollBar(), &QScrollBar::valueChanged,
+		viewport(), qOverload<>(&QWidget::update));
+	connect(verticalScrollBar(), &QScrollBar::valueChanged,
+		viewport(), qOverload<>(&QWidget::update));
+	updateScrollBars();
+}
+
+ConsoleView::~ConsoleView()
+{
+}
+
+void ConsoleView::setMaxLines(std::size_t max_lines)
+{
+	buffer.setMaxLines(max_lines);
+	updateView();
+}
+
+void ConsoleView::append(DFHack::Color color, QStringView text)
+{
+	buffer.append(color, text);
+	scheduleUpdate();
+}
+
+void ConsoleView::appendCommand(const QString &command)
+{
+	buffer.newLine(ConsoleBuffer::Style::Command);
+	buffer.append(DFHack::Color::Black, command);
+	buffer.newLine();
+	// Always show the command that was just sent
+	verticalScrollBar()->setValue(verticalScrollBar()->maximum());
+	scheduleUpdate();
+}
+
+void ConsoleView::newLine()
+{
+	buffer.newLine();
+	scheduleUpdate();
+}
+
+void ConsoleView::clear()
+{
+	buffer.clear();
+	updateView();
+}
+
+void ConsoleView::paintEvent(QPaintEvent *)
+{
+	QPainter painter(viewport());
+	auto metrics = fontMetrics();
+	auto line_height = metrics.lineSpacing();
+	auto first = std::size_t(verticalScrollBar()->value());
+	auto last = std::min(buffer.size(), first + visibleLines() + 1);
+	auto left = -horizontalScrollBar()->value();
+	auto width = viewport()->width();
+	for (auto i = first; i < last; ++i) {
+		const auto &line = buffer.line(i);
+		int top = int(i - first) * line_height;
+		if (line.style == ConsoleBuffer::Style::Command)
+			painter.fillRect(0, top, width, line_height, Qt::darkBlue);
+		int x = left;
+		for (const auto &span: line.spans) {
+			if (x >= width)
+				break;
+			auto text = line.text.mid(span.begin, span.length);
+			auto advance = metrics.horizontalAdvance(text);
+			if (x + advance > 0) {
+				painter.setPen(get_color_code(palette(), span.color));
+				painter.drawText(x, top + metrics.ascent(), text);
+			}
+			x += advance;
+		}
+	}
+}
+
+void ConsoleView::resizeEvent(QResizeEvent *event)
+{
+	QAbstractScrollArea::resizeEvent(event);
+	updateScrollBars();
+}
+
+void ConsoleView::changeEvent(QEvent *event)
+{
+	QAbstractScrollArea::changeEvent(event);
+	if (event->type() == QEvent::FontChange)
+		updateScrollBars();
+}
+
+void ConsoleView::scheduleUpdate()
+{
+	if (!update_timer.isActive())
+		update_timer.start();
+}
+
+void ConsoleView::updateView()
+{
+	update_timer.stop();
+	auto scroll = verticalScrollBar();
+	bool at_bottom = scroll->value() >= scroll->maximum();
+	// Keep the same lines visible when older lines were dropped
+	auto dropped = buffer.dropped() - dropped_lines;
+	dropped_lines = buffer.dropped();
+	int value = scroll->value() - int(std::min<std::uint64_t>(dropped, scroll->value()));
+	updateVerticalScrollBar();
+	scroll->setValue(at_bottom ? scroll->maximum() : value);
+	updateHorizontalScrollBar();
+	viewport()->update();
+}
+
+void ConsoleView::updateScrollBars()
+{
+	updateVerticalScrollBar();
+	updateHorizontalScrollBar();
+}
+
+void ConsoleView::updateVerticalScrollBar()
+{
+	auto visible = visibleLines();
+	auto scroll = verticalScrollBar();
+	scroll->setPageStep(visible);
+	scroll->setSingleStep(1);
+	scroll->setRange(0, std::max(0, int(buffer.size()) - visible));
+}
+
+void ConsoleView::updateHorizontalScrollBar()
+{
+	// Only measure the lines that may be shown, the fixed font makes
+	// their widths close enough to the rest.
+	auto metrics = fontMetrics();
+	int max_width = 0;
+	auto first = std::size_t(verticalScrollBar()->value());
+	auto last = std::min(buffer.size(), first + visibleLines() + 1);
+	for (auto i = first; i < last; ++i)
+		max_width = std::max(max_width, metrics.horizontalAdvance(buffer.line(i).text));
+	auto hscroll = horizontalScrollBar();
+	hscroll->setPageStep(viewport()->width());
+	hscroll->setSingleStep(metrics.averageCharWidth());
+	hscroll->setRange(0, std::max(0, max_width - viewport()->width()));
+}
+
+int ConsoleView::visibleLines() const
+{
+	return std::max(1, viewport()->height() / fontMetrics().lineSpacing());
+}
@@ -0,0 +1,76 @@
+/*
+ * Copyright 2023 Clement Vuchener
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef CONSOLE_VIEW_H
+#define CONSOLE_VIEW_H
+
+#include <QAbstractScrollArea>
+#include <QTimer>
+
+#include "ConsoleBuffer.h"
+
+/**
+ * Read-only console output.
+ *
+ * Text is stored in a ConsoleBuffer with a scrollback limit and only the
+ * visible lines are painted. Appending only marks the view as dirty,
+ * scroll bars and the viewport are updated at most once per frame.
+ */
+class ConsoleView: public QAbstractScrollArea
+{
+	Q_OBJECT
+public:
+	ConsoleView(QWidget *parent = nullptr);
+	~ConsoleView() override;
+
+	void setMaxLines(std::size_t max_lines);
+	std::size_t maxLines() const { return buffer.maxLines(); }
+
+	/**
+	 * Append command output, newlines in \p text start new lines.
+	 */
+	void append(DFHack::Color color, QStringView text);
+	/**
+	 * Append a command line, highlighted with the command background.
+	 */
+	void appendCommand(const QString &command);
+	/**
+	 * Start a new output line if the current one is not empty.
+	 */
+	void newLine();
+	void clear();
+
+protected:
+	void paintEvent(QPaintEvent *event) override;
+	void resizeEvent(QResizeEvent *event) override;
+	void changeEvent(QEvent *event) override;
+
+private:
+	void scheduleUpdate();
+	void updateView();
+	void updateScrollBars();
+	void updateVerticalScrollBar();
+	void updateHorizontalScrollBar();
+	int visibleLines() const;
+
+	ConsoleBuffer buffer;
+	std::uint64_t dropped_lines; // buffer.dropped() at the last update
+	QTimer update_timer;
+};
+
+#endif
@@ -18,10 +18,10 @@
 
 #include "MainWindow.h"
 
-#include <QFontDatabase>
-
 #include <QtDebug>
 
+#include <dfhack-client-qt/NotificationSink.h>
+
 #include <iomanip>
 #include <sstream>
 
@@ -38,19 +38,10 @@ MainWindow::MainWindow(QWidget *parent)
 	status_bar->addPermanentWidget(connection_status);
 	disconnect_action->setEnabled(false);
 
-	command_format.setBackground(Qt::darkBlue);
-	result_format.setBackground(Qt::darkGreen);
-
-	char_format.setFont(QFontDatabase::systemFont(QFontDatabase::FixedFont));
-
 	connect(&client, &DFHack::Client::connectionChanged,
 		this, &MainWindow::dfhackConnectionChanged);
 	connect(&client, &DFHack::Client::socketError,
 		this, &MainWindow::dfhackSocketError);
-	connect(&notification_watcher, &decltype(notification_watcher)::started,
-		this, &MainWindow::dfhackTextStarted);
-	connect(&notification_watcher, &decltype(notification_watcher)::resultsReadyAt,
-		this, &MainWindow::dfhackTextMessage);
 	connect(&command_watcher, &decltype(command_watcher)::started,
 		this, &MainWindow::dfhackCommandStarted);
 	connect(&command_watcher, &decltype(command_watcher)::finished,
@@ -110,18 +101,21 @@ static std::optional<dfproto::CoreRunCommandRequest> parse_command(const std::st
 
 void MainWindow::on_send_command_action_triggered()
 {
-	QTextCursor cursor(console_output->document());
-	cursor.movePosition(QTextCursor::End);
-	cursor.insertBlock(command_format, char_format);
-	cursor.insertText(command_line->text());
-	console_output->setTextCursor(cursor);
+	console_output->appendCommand(command_line->text());
 
 	status_bar->clearMessage();
 
 	if (auto args = parse_command(command_line->text().toStdString())) {
-		auto [res, text] = core.runCommand(client, *args);
+		// The client lives in this thread, text is written directly to
+		// the console without being stored in the call future.
+		DFHack::CallOptions options;
+		options.notification_sink = std::make_shared<DFHack::CallbackSink>(
+			[view = console_output](DFHack::Color color, std::string_view text) {
+				view->append(color, QString::fromUtf8(text.data(), text.size()));
+			});
+		options.keep_notifications = false;
+		auto [res, text] = core.runCommand(client, *args, options);
 		command_watcher.setFuture(res);
-		notification_watcher.setFuture(text);
 	}
 	else
 		status_bar->showMessage(tr("Failed to parse command"));
@@ -154,67 +148,6 @@ void MainWindow::dfhackSocketError(QAbstractSocket::SocketError, const QString &
 	status_bar->showMessage(error_string);
 }
 
-static QColor get_color_code(const QPalette &palette, DFHack::Color color)
-{
-	using DFHack::Color;
-	switch (color) {
-	case Color::Black:
-		return palette.color(QPalette::WindowText);
-	case Color::Blue:
-		return "#000080";
-	case Color::Green:
-		return "#008000";
-	case Color::Cyan:
-		return "#008080";
-	case Color::Red:
-		return "#800000";
-	case Color::Magenta:
-		return "#800080";
-	case Color::Brown:
-		return "#808000";
-	case Color::Grey:
-		return "#c0c0c0";
-	case Color::DarkGrey:
-		return "#808080";
-	case Color::LightBlue:
-		return "#0000ff";
-	case Color::LightGreen:
-		return "#00ff00";
-	case Color::LightCyan:
-		return "#00ffff";
-	case Color::LightRed:
-		return "#ff0000";
-	case Color::LightMagenta:
-		return "#ff00ff";
-	case Color::Yellow:
-		return "#ffff00";
-	case Color::White:
-		return palette.color(QPalette::Window);
-	default:
-		return "";
-	}
-}
-
-void MainWindow::dfhackTextStarted()
-{
-	QTextCursor cursor(console_output->document());
-	cursor.movePosition(QTextCursor::End);
-	cursor.insertBlock(notification_format, char_format);
-}
-
-void MainWindow::dfhackTextMessage(int begin, int end)
-{
-	for (int i = begin; i < end; ++i) {
-		auto [color, text] = notification_watcher.future().resultAt(i);
-		QTextCursor cursor(console_output->document());
-		cursor.movePosition(QTextCursor::End);
-		QTextCharFormat format = char_format;
-		format.setForeground(get_color_code(console_output->palette(), color));
-		cursor.insertText(text, format);
-		console_output->setTextCursor(cursor);
-	}
-}
-
 void MainWindow::dfhackCommandStarted()
 {
 	status_bar->showMessage("Executing command");
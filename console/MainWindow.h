@@ -46,8 +46,6 @@ private slots:
 
 	void dfhackConnectionChanged(bool connected);
 	void dfhackSocketError(QAbstractSocket::SocketError error, const QString &error_string);
-	void dfhackTextStarted();
-	void dfhackTextMessage(int begin, int end);
 	void dfhackCommandStarted();
 	void dfhackCommandFinished();
 
@@ -58,10 +56,6 @@ private:
 	DFHack::Core core;
 
 	QFutureWatcher<DFHack::CallReply<dfproto::EmptyMessage>> command_watcher;
-	QFutureWatcher<std::pair<DFHack::Color, QString>> notification_watcher;
-
-	QTextBlockFormat command_format, notification_format, result_format;
-	QTextCharFormat char_format;
 };
 
 #endif
@@ -38,6 +38,18 @@ struct Basic
 	const Function<dfproto::ListUnitsIn, dfproto::ListUnitsOut> listUnits = {"", "ListUnits"};
 	const Function<dfproto::ListSquadsIn, dfproto::ListSquadsOut> listSquads = {"", "ListSquads"};
 	const Function<dfproto::SetUnitLaborsIn, dfproto::EmptyMessage> setUnitLabors = {"", "SetUnitLabors"};
+
+	/**
+	 * Bind all the functions at once.
+	 *
+	 * \see DFHack::bindAll
+	 */
+	QFuture<Client::BindFailures> bindAll(Client &client) const
+	{
+		return DFHack::bindAll(client, getVersion, getDFVersion, getWorldInfo,
+				listEnums, listJobSkills, listMaterials, listUnits,
+				listSquads, setUnitLabors);
+	}
 };
 
 } // namespace DFHack
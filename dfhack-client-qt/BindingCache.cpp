@@ -0,0 +1,156 @@
+/*
+ * Copyright 2023 Clement Vuchener
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <dfhack-client-qt/BindingCache.h>
+
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QSaveFile>
+
+using namespace DFHack;
+
+static QString to_qstring(const std::string &str)
+{
+	return QString::fromStdString(str);
+}
+
+static std::string to_string(const QJsonValue &value)
+{
+	return value.toString().toStdString();
+}
+
+BindingCache::BindingCache()
+{
+}
+
+BindingCache::~BindingCache()
+{
+}
+
+bool BindingCache::load(const QString &filename)
+{
+	QFile file(filename);
+	if (!file.open(QIODevice::ReadOnly))
+		return false;
+	QJsonParseError error;
+	auto doc = QJsonDocument::fromJson(file.readAll(), &error);
+	if (error.error != QJsonParseError::NoError || !doc.isObject())
+		return false;
+
+	std::map<QString, ServerVersion> new_servers;
+	std::map<Key, int> new_ids;
+	auto servers_obj = doc.object().value("servers").toObject();
+	for (auto it = servers_obj.begin(); it != servers_obj.end(); ++it) {
+		auto server = it.value().toObject();
+		new_servers.emplace(it.key(), ServerVersion{
+				to_string(server.value("version")),
+				to_string(server.value("df_version"))});
+	}
+	for (const auto &value: doc.object().value("bindings").toArray()) {
+		auto binding = value.toObject();
+		new_ids.emplace(Key{
+				to_string(binding.value("version")),
+				to_string(binding.value("df_version")),
+				to_string(binding.value("plugin")),
+				to_string(binding.value("method")),
+				to_string(binding.value("input_msg")),
+				to_string(binding.value("output_msg"))},
+			binding.value("id").toInt());
+	}
+
+	QMutexLocker lock(&mutex);
+	servers = std::move(new_servers);
+	ids = std::move(new_ids);
+	return true;
+}
+
+bool BindingCache::save(const QString &filename) const
+{
+	QJsonObject servers_obj;
+	QJsonArray bindings;
+	{
+		QMutexLocker lock(&mutex);
+		for (const auto &[server, version]: servers)
+			servers_obj.insert(server, QJsonObject{
+					{"version", to_qstring(version.version)},
+					{"df_version", to_qstring(version.df_version)}});
+		for (const auto &[key, id]: ids) {
+			const auto &[version, df_version, plugin, method, input_msg, output_msg] = key;
+			bindings.append(QJsonObject{
+					{"version", to_qstring(version)},
+					{"df_version", to_qstring(df_version)},
+					{"plugin", to_qstring(plugin)},
+					{"method", to_qstring(method)},
+					{"input_msg", to_qstring(input_msg)},
+					{"output_msg", to_qstring(output_msg)},
+					{"id", id}});
+		}
+	}
+	QSaveFile file(filename);
+	if (!file.open(QIODevice::WriteOnly))
+		return false;
+	file.write(QJsonDocument(QJsonObject{
+			{"servers", servers_obj},
+			{"bindings", bindings}}).toJson());
+	return file.commit();
+}
+
+std::optional<BindingCache::ServerVersion> BindingCache::serverVersion(const QString &server) const
+{
+	QMutexLocker lock(&mutex);
+	auto it = servers.find(server);
+	if (it == servers.end())
+		return std::nullopt;
+	return it->second;
+}
+
+void BindingCache::setServerVersion(const QString &server, const ServerVersion &version)
+{
+	QMutexLocker lock(&mutex);
+	servers.insert_or_assign(server, version);
+}
+
+std::optional<int> BindingCache::id(const ServerVersion &version, const dfproto::CoreBindRequest &request) const
+{
+	QMutexLocker lock(&mutex);
+	auto it = ids.find(make_key(version, request));
+	if (it == ids.end())
+		return std::nullopt;
+	return it->second;
+}
+
+void BindingCache::setId(const ServerVersion &version, const dfproto::CoreBindRequest &request, int id)
+{
+	QMutexLocker lock(&mutex);
+	ids.insert_or_assign(make_key(version, request), id);
+}
+
+void BindingCache::removeId(const ServerVersion &version, const dfproto::CoreBindRequest &request)
+{
+	QMutexLocker lock(&mutex);
+	ids.erase(make_key(version, request));
+}
+
+BindingCache::Key BindingCache::make_key(const ServerVersion &version, const dfproto::CoreBindRequest &request)
+{
+	return {version.version, version.df_version,
+		request.plugin(), request.method(),
+		request.input_msg(), request.output_msg()};
+}
@@ -0,0 +1,107 @@
+/*
+ * Copyright 2023 Clement Vuchener
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef DFHACK_CLIENT_QT_DFHACK_BINDING_CACHE_H
+#define DFHACK_CLIENT_QT_DFHACK_BINDING_CACHE_H
+
+#include <QMutex>
+#include <QString>
+
+#include <map>
+#include <optional>
+#include <string>
+#include <tuple>
+
+#include <dfhack-client-qt/globals.h>
+#include <dfhack-client-qt/CoreProtocol.pb.h>
+
+namespace DFHack
+{
+
+/**
+ * Binding ids remembered between connections, keyed by server version.
+ *
+ * DFHack gives fixed ids to core methods (methods with an empty plugin name)
+ * for a given version. A client using a binding cache calls them directly
+ * with the cached ids instead of binding them first, while checking the
+ * server version in the background. If a cached id turns out to be invalid,
+ * the method is bound again and the call is retried.
+ *
+ * Plugin methods are never recorded: their ids depend on the order plugins
+ * are first bound in a connection, so a cached id could reach another method.
+ *
+ * The cache can be saved to and loaded from a file, so that short-lived
+ * programs skip the bind round trips after their first run.
+ *
+ * This is thread-safe.
+ *
+ * \see Client::setBindingCache
+ */
+class DFHACK_CLIENT_QT_EXPORT BindingCache
+{
+public:
+	struct ServerVersion
+	{
+		std::string version; ///< GetVersion result
+		std::string df_version; ///< GetDFVersion result
+
+		bool operator==(const ServerVersion &) const = default;
+	};
+
+	BindingCache();
+	~BindingCache();
+
+	/**
+	 * Replace the cache content with the content of file \p filename.
+	 *
+	 * \returns false if the file could not be read or parsed, the cache
+	 * is left unchanged in this case.
+	 */
+	bool load(const QString &filename);
+	/**
+	 * Write the cache content to file \p filename.
+	 */
+	bool save(const QString &filename) const;
+
+	/**
+	 * Last version seen for \p server ("host:port").
+	 */
+	std::optional<ServerVersion> serverVersion(const QString &server) const;
+	void setServerVersion(const QString &server, const ServerVersion &version);
+
+	/**
+	 * Get the cached id of method \p request for server version
+	 * \p version.
+	 */
+	std::optional<int> id(const ServerVersion &version, const dfproto::CoreBindRequest &request) const;
+	void setId(const ServerVersion &version, const dfproto::CoreBindRequest &request, int id);
+	void removeId(const ServerVersion &version, const dfproto::CoreBindRequest &request);
+
+private:
+	// version, DF version, plugin, method, input message, output message
+	using Key = std::tuple<std::string, std::string, std::string, std::string, std::string, std::string>;
+	static Key make_key(const ServerVersion &version, const dfproto::CoreBindRequest &request);
+
+	mutable QMutex mutex;
+	std::map<QString, ServerVersion> servers;
+	std::map<Key, int> ids;
+};
+
+} // namespace DFHack
+
+#endif
@@ -0,0 +1,278 @@
+/*
+ * Copyright 2023 Clement Vuchener
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <dfhack-client-qt/BlockingClient.h>
+#include <dfhack-client-qt/Framing.h>
+#include <dfhack-client-qt/NotificationSink.h>
+
+#include <google/protobuf/io/coded_stream.h>
+
+#include <QTcpSocket>
+
+#include <map>
+#include <tuple>
+#include <vector>
+
+#include <QtDebug>
+#include <QLoggingCategory>
+Q_DECLARE_LOGGING_CATEGORY(ClientLog)
+
+using namespace DFHack;
+
+static constexpr int16_t BindMethodId = 0;
+
+using bind_key_t = std::tuple<std::string, std::string, std::string, std::string>;
+
+static bind_key_t make_bind_key(const dfproto::CoreBindRequest &request)
+{
+	return {request.plugin(), request.method(), request.input_msg(), request.output_msg()};
+}
+
+struct BlockingClient::Private
+{
+	static constexpr std::size_t ReadChunkSize = 64*1024;
+
+	QTcpSocket socket;
+	std::map<bind_key_t, int16_t> bindings; // ids for the current connection
+	std::vector<char> read_buffer = std::vector<char>(ReadChunkSize);
+	dfproto::CoreTextNotification notification;
+
+	bool connected() const
+	{
+		return socket.state() == QAbstractSocket::ConnectedState;
+	}
+
+	void close()
+	{
+		socket.abort();
+		bindings.clear();
+	}
+
+	// The connection state is unknown after a failure, it cannot be reused.
+	CommandResult fail(CommandResult cr)
+	{
+		close();
+		return cr;
+	}
+
+	bool waitForBytes(qint64 size, const QDeadlineTimer &deadline)
+	{
+		while (socket.bytesAvailable() < size) {
+			if (!socket.waitForReadyRead(deadline.remainingTime())) {
+				if (!deadline.hasExpired())
+					qCCritical(ClientLog) << "Failed to read data from socket:" << socket.errorString();
+				return false;
+			}
+		}
+		return true;
+	}
+
+	bool read(void *data, qint64 size, const QDeadlineTimer &deadline)
+	{
+		return waitForBytes(size, deadline)
+			&& socket.read(static_cast<char *>(data), size) == size;
+	}
+
+	bool write(const char *data, qint64 size, const QDeadlineTimer &deadline)
+	{
+		if (socket.write(data, size) != size) {
+			qCCritical(ClientLog) << "Failed to write data to socket:" << socket.errorString();
+			return false;
+		}
+		while (socket.bytesToWrite() > 0)
+			if (!socket.waitForBytesWritten(deadline.remainingTime()))
+				return false;
+		return true;
+	}
+};
+
+BlockingClient::BlockingClient()
+	: p(std::make_unique<Private>())
+{
+}
+
+BlockingClient::~BlockingClient()
+{
+	disconnect();
+}
+
+bool BlockingClient::connect(const QString &host, quint16 port, QDeadlineTimer deadline)
+{
+	if (p->connected())
+		return true;
+	p->close();
+	p->socket.connectToHost(host, port);
+	if (!p->socket.waitForConnected(deadline.remainingTime())) {
+		qCCritical(ClientLog) << "Failed to connect:" << p->socket.errorString();
+		p->close();
+		return false;
+	}
+	// Requests are small and always wait for their reply
+	p->socket.setSocketOption(QAbstractSocket::LowDelayOption, 1);
+	auto request = handshake_request();
+	HandshakePacket reply;
+	if (!p->write(reinterpret_cast<const char *>(&request), sizeof(request), deadline)
+			|| !p->read(&reply, sizeof(reply), deadline)) {
+		p->close();
+		return false;
+	}
+	if (!is_handshake_reply(reply)) {
+		qCCritical(ClientLog) << "Handshake message mismatch" << QByteArray(reply.magic, HandshakePacket::MagicSize);
+		p->close();
+		return false;
+	}
+	return true;
+}
+
+void BlockingClient::disconnect()
+{
+	if (p->connected()) {
+		auto frame = serialize_frame(dfproto::EmptyMessage());
+		set_frame_header(frame, MessageHeader::RequestQuit);
+		// The server closes the connection
+		QDeadlineTimer deadline(std::chrono::seconds(1));
+		if (p->write(frame.data(), frame.size(), deadline)
+				&& p->socket.state() != QAbstractSocket::UnconnectedState)
+			p->socket.waitForDisconnected(deadline.remainingTime());
+	}
+	p->close();
+}
+
+bool BlockingClient::isConnected() const
+{
+	return p->connected();
+}
+
+CommandResult BlockingClient::bind(const dfproto::CoreBindRequest &request, int16_t &id,
+		const CallOptions &options)
+{
+	auto key = make_bind_key(request);
+	auto it = p->bindings.find(key);
+	if (it != p->bindings.end()) {
+		id = it->second;
+		return CommandResult::Ok;
+	}
+	dfproto::CoreBindReply reply;
+	auto cr = call(BindMethodId, request, &reply, nullptr, options);
+	if (cr != CommandResult::Ok)
+		return cr;
+	id = reply.assigned_id();
+	p->bindings.emplace(std::move(key), id);
+	return CommandResult::Ok;
+}
+
+CommandResult BlockingClient::call(int16_t id,
+		const google::protobuf::MessageLite &in,
+		google::protobuf::MessageLite &out,
+		const CallOptions &options)
+{
+	return call(id, in, &out, nullptr, options);
+}
+
+CommandResult BlockingClient::call(const dfproto::CoreBindRequest &bind_request,
+		const google::protobuf::MessageLite &in,
+		google::protobuf::MessageLite &out,
+		const CallOptions &options)
+{
+	int16_t id;
+	if (auto cr = bind(bind_request, id, options); cr != CommandResult::Ok)
+		return cr;
+	return call(id, in, &out, nullptr, options);
+}
+
+CommandResult BlockingClient::call(int16_t id,
+		const google::protobuf::MessageLite &in,
+		Client::ReplyDecoder &decoder,
+		const CallOptions &options)
+{
+	return call(id, in, nullptr, &decoder, options);
+}
+
+CommandResult BlockingClient::call(const dfproto::CoreBindRequest &bind_request,
+		const google::protobuf::MessageLite &in,
+		Client::ReplyDecoder &decoder,
+		const CallOptions &options)
+{
+	int16_t id;
+	if (auto cr = bind(bind_request, id, options); cr != CommandResult::Ok)
+		return cr;
+	return call(id, in, nullptr, &decoder, options);
+}
+
+CommandResult BlockingClient::call(int16_t id,
+		const google::protobuf::MessageLite &in,
+		google::protobuf::MessageLite *out,
+		Client::ReplyDecoder *decoder,
+		const CallOptions &options)
+{
+	if (!p->connected())
+		return CommandResult::LinkFailure;
+	const auto &deadline = options.deadline;
+	auto timeout_or = [&deadline](CommandResult cr) {
+		return deadline.hasExpired() ? CommandResult::Timeout : cr;
+	};
+
+	auto frame = serialize_frame(in);
+	set_frame_header(frame, id);
+	if (!p->write(frame.data(), frame.size(), deadline))
+		return p->fail(timeout_or(CommandResult::LinkFailure));
+
+	while (true) {
+		MessageHeader header;
+		if (!p->read(&header, sizeof(header), deadline))
+			return p->fail(timeout_or(CommandResult::LinkFailure));
+		if (header.id == MessageHeader::ReplyFail) {
+			if (header.size < -3 || header.size > 3)
+				return CommandResult::LinkFailure;
+			return static_cast<CommandResult>(header.size);
+		}
+		if (header.size < 0 || header.size > MessageHeader::MaxMessageSize) {
+			qCCritical(ClientLog) << "Invalid message size" << header.size;
+			return p->fail(CommandResult::LinkFailure);
+		}
+		// Parse directly from the socket buffer once the whole payload
+		// is there.
+		if (!p->waitForBytes(header.size, deadline))
+			return p->fail(timeout_or(CommandResult::LinkFailure));
+		SocketInputStream input(p->socket, header.size, p->read_buffer);
+		switch (header.id) {
+		case MessageHeader::ReplyResult: {
+			bool parsed;
+			if (decoder) {
+				google::protobuf::io::CodedInputStream coded(&input);
+				parsed = decoder->decode(coded);
+			}
+			else
+				parsed = out->ParseFromZeroCopyStream(&input);
+			input.skipRemaining();
+			return parsed ? CommandResult::Ok : CommandResult::LinkFailure;
+		}
+		case MessageHeader::ReplyText:
+			if (!p->notification.ParseFromZeroCopyStream(&input))
+				qCCritical(ClientLog) << "Failed to parse CoreTextNotification";
+			input.skipRemaining();
+			if (options.notification_sink)
+				for (const auto &fragment: p->notification.fragments())
+					options.notification_sink->write(static_cast<Color>(fragment.color()), fragment.text());
+			break;
+		default:
+			qCCritical(ClientLog) << "Unknown message id in header";
+			return p->fail(CommandResult::LinkFailure);
+		}
+	}
+}
@@ -0,0 +1,128 @@
+/*
+ * Copyright 2023 Clement Vuchener
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef DFHACK_CLIENT_QT_DFHACK_BLOCKING_CLIENT_H
+#define DFHACK_CLIENT_QT_DFHACK_BLOCKING_CLIENT_H
+
+#include <dfhack-client-qt/Client.h>
+
+#include <memory>
+
+namespace DFHack
+{
+
+/**
+ * DFHack remote protocol client doing blocking I/O in the calling thread.
+ *
+ * Calls are sent and their replies read before returning, without any
+ * event loop, signal or future. This is meant for command line tools and
+ * worker threads that make one call at a time: there is no pipelining,
+ * priority or shared binding cache.
+ *
+ * The client must be used from the thread that created it.
+ *
+ * Function objects can call through a blocking client:
+ * \code
+ * DFHack::BlockingClient client;
+ * DFHack::Core core;
+ * if (client.connect("localhost")) {
+ *     auto reply = core.suspend(client);
+ *     ...
+ * }
+ * \endcode
+ */
+class DFHACK_CLIENT_QT_EXPORT BlockingClient
+{
+public:
+	BlockingClient();
+	~BlockingClient();
+
+	/**
+	 * Connect to \p host and do the protocol handshake.
+	 *
+	 * \returns true on success.
+	 */
+	bool connect(const QString &host, quint16 port = Client::DefaultPort,
+			QDeadlineTimer deadline = QDeadlineTimer(QDeadlineTimer::Forever));
+	/**
+	 * Send a quit request and close the connection.
+	 */
+	void disconnect();
+	bool isConnected() const;
+
+	/**
+	 * Bind a method, reusing the id of a previous bind of the same
+	 * connection.
+	 *
+	 * \returns CommandResult::Ok and sets \p id if the method was bound.
+	 */
+	CommandResult bind(const dfproto::CoreBindRequest &request, int16_t &id,
+			const CallOptions &options = {});
+
+	/**
+	 * Call function \p id with parameters \p in and parse the reply in
+	 * \p out.
+	 *
+	 * Only CallOptions::deadline and CallOptions::notification_sink are
+	 * used, the sink is written from the calling thread. When the deadline
+	 * expires or the connection fails the connection is closed.
+	 */
+	CommandResult call(int16_t id,
+			const google::protobuf::MessageLite &in,
+			google::protobuf::MessageLite &out,
+			const CallOptions &options = {});
+	/**
+	 * Call the function described by \p bind_request, binding it first if
+	 * needed.
+	 *
+	 * \see call(int16_t, const google::protobuf::MessageLite &, google::protobuf::MessageLite &, const CallOptions &)
+	 */
+	CommandResult call(const dfproto::CoreBindRequest &bind_request,
+			const google::protobuf::MessageLite &in,
+			google::protobuf::MessageLite &out,
+			const CallOptions &options = {});
+	/**
+	 * Call function \p id and decode the reply with \p decoder.
+	 */
+	CommandResult call(int16_t id,
+			const google::protobuf::MessageLite &in,
+			Client::ReplyDecoder &decoder,
+			const CallOptions &options = {});
+	/**
+	 * Call the function described by \p bind_request and decode the reply
+	 * with \p decoder.
+	 */
+	CommandResult call(const dfproto::CoreBindRequest &bind_request,
+			const google::protobuf::MessageLite &in,
+			Client::ReplyDecoder &decoder,
+			const CallOptions &options = {});
+
+private:
+	CommandResult call(int16_t id,
+			const google::protobuf::MessageLite &in,
+			google::protobuf::MessageLite *out,
+			Client::ReplyDecoder *decoder,
+			const CallOptions &options);
+
+	struct Private;
+	std::unique_ptr<Private> p;
+};
+
+} // namespace DFHack
+
+#endif
@@ -0,0 +1,149 @@
+/*
+ * Copyright 2023 Clement Vuchener
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <dfhack-client-qt/Capture.h>
+
+#include <algorithm>
+
+using namespace DFHack;
+
+static void append_varint(std::string &out, std::uint64_t value)
+{
+	while (value >= 0x80) {
+		out.push_back(static_cast<char>(value | 0x80));
+		value >>= 7;
+	}
+	out.push_back(static_cast<char>(value));
+}
+
+static bool read_varint(const char *&pos, const char *end, std::uint64_t &value)
+{
+	value = 0;
+	for (int shift = 0; shift < 64 && pos != end; shift += 7) {
+		auto byte = static_cast<std::uint8_t>(*pos++);
+		value |= std::uint64_t(byte & 0x7f) << shift;
+		if (!(byte & 0x80))
+			return true;
+	}
+	return false;
+}
+
+CaptureWriter::CaptureWriter()
+{
+}
+
+CaptureWriter::~CaptureWriter()
+{
+	close();
+}
+
+bool CaptureWriter::open(const QString &filename)
+{
+	QMutexLocker lock(&mutex);
+	if (file.isOpen())
+		return false;
+	file.setFileName(filename);
+	if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate))
+		return false;
+	buffer.assign(Capture::Magic, Capture::MagicSize);
+	last = std::chrono::steady_clock::now();
+	return true;
+}
+
+bool CaptureWriter::close()
+{
+	QMutexLocker lock(&mutex);
+	if (!file.isOpen())
+		return false;
+	bool ok = flush();
+	file.close();
+	return ok;
+}
+
+bool CaptureWriter::isOpen() const
+{
+	QMutexLocker lock(&mutex);
+	return file.isOpen();
+}
+
+void CaptureWriter::record(Capture::Event event, const char *data, std::size_t size)
+{
+	auto now = std::chrono::steady_clock::now();
+	QMutexLocker lock(&mutex);
+	if (!file.isOpen())
+		return;
+	auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(now - last);
+	// Keep the rounding error for the next record
+	last += elapsed;
+	buffer.push_back(static_cast<char>(event));
+	append_varint(buffer, elapsed.count());
+	append_varint(buffer, size);
+	buffer.append(data, size);
+	if (buffer.size() >= FlushSize)
+		flush();
+}
+
+bool CaptureWriter::flush()
+{
+	auto written = file.write(buffer.data(), buffer.size());
+	bool ok = written == qint64(buffer.size());
+	buffer.clear();
+	return ok;
+}
+
+bool CaptureReader::load(const QString &filename)
+{
+	all_records.clear();
+	QFile file(filename);
+	if (!file.open(QIODevice::ReadOnly))
+		return false;
+	content = file.readAll();
+	const char *pos = content.constData();
+	const char *end = pos + content.size();
+	if (std::size_t(end - pos) < Capture::MagicSize
+			|| !std::equal(pos, pos + Capture::MagicSize, Capture::Magic))
+		return false;
+	pos += Capture::MagicSize;
+	std::chrono::microseconds time{0};
+	while (pos != end) {
+		auto event = static_cast<Capture::Event>(*pos++);
+		if (event > Capture::Event::Received)
+			return false;
+		std::uint64_t elapsed, size;
+		if (!read_varint(pos, end, elapsed) || !read_varint(pos, end, size))
+			return false;
+		if (size > std::uint64_t(end - pos))
+			return false;
+		time += std::chrono::microseconds(elapsed);
+		all_records.push_back({event, time, {pos, static_cast<std::size_t>(size)}});
+		pos += size;
+	}
+	return true;
+}
+
+std::vector<std::vector<CaptureReader::Record>> CaptureReader::connections() const
+{
+	std::vector<std::vector<Record>> result;
+	for (const auto &record: all_records) {
+		if (record.event == Capture::Event::Connection)
+			result.emplace_back();
+		else if (!result.empty())
+			result.back().push_back(record);
+	}
+	return result;
+}
@@ -0,0 +1,129 @@
+/*
+ * Copyright 2023 Clement Vuchener
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef DFHACK_CLIENT_QT_DFHACK_CAPTURE_H
+#define DFHACK_CLIENT_QT_DFHACK_CAPTURE_H
+
+#include <QFile>
+#include <QMutex>
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <dfhack-client-qt/globals.h>
+
+namespace DFHack
+{
+
+/**
+ * Capture file of the bytes exchanged by a Client.
+ *
+ * The file starts with the 8 bytes "DFHKCAP1", followed by records:
+ *  - event type (1 byte, see \ref Event),
+ *  - time since the previous record in microseconds (varint),
+ *  - data size (varint),
+ *  - data.
+ *
+ * Varints use the protobuf encoding.
+ */
+namespace Capture
+{
+
+enum class Event: std::uint8_t
+{
+	Connection = 0, ///< a new connection starts, without data
+	Sent = 1, ///< bytes written by the client
+	Received = 2, ///< bytes read by the client
+};
+
+static constexpr char Magic[] = "DFHKCAP1";
+static constexpr std::size_t MagicSize = sizeof(Magic) - 1;
+
+} // namespace Capture
+
+/**
+ * Writes a capture file.
+ *
+ * Records are buffered and written in large blocks. Recording is
+ * thread-safe.
+ *
+ * \see Client::setCapture
+ */
+class DFHACK_CLIENT_QT_EXPORT CaptureWriter
+{
+public:
+	CaptureWriter();
+	~CaptureWriter();
+
+	bool open(const QString &filename);
+	/**
+	 * Write buffered records and close the file.
+	 */
+	bool close();
+	bool isOpen() const;
+
+	void record(Capture::Event event, const char *data = nullptr, std::size_t size = 0);
+
+private:
+	bool flush();
+
+	static constexpr std::size_t FlushSize = 256*1024;
+
+	mutable QMutex mutex;
+	QFile file;
+	std::string buffer;
+	std::chrono::steady_clock::time_point last;
+};
+
+/**
+ * Reads a capture file.
+ */
+class DFHACK_CLIENT_QT_EXPORT CaptureReader
+{
+public:
+	struct Record
+	{
+		Capture::Event event;
+		std::chrono::microseconds time; ///< since the start of the capture
+		std::string_view data; ///< points into the reader buffer
+	};
+
+	/**
+	 * Read and parse the whole file.
+	 *
+	 * \returns false if the file cannot be read or is not a valid capture.
+	 */
+	bool load(const QString &filename);
+
+	const std::vector<Record> &records() const { return all_records; }
+	/**
+	 * Records of each connection, without the Connection records.
+	 */
+	std::vector<std::vector<Record>> connections() const;
+
+private:
+	QByteArray content;
+	std::vector<Record> all_records;
+};
+
+} // namespace DFHack
+
+#endif
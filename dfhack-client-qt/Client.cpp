@@ -17,13 +17,28 @@
  */
 
 #include <dfhack-client-qt/Client.h>
+#include <dfhack-client-qt/BindingCache.h>
+#include <dfhack-client-qt/Capture.h>
+#include <dfhack-client-qt/Framing.h>
+#include <dfhack-client-qt/Metrics.h>
+#include <dfhack-client-qt/NotificationSink.h>
+#include <dfhack-client-qt/Protocol.h>
+
+#include <google/protobuf/io/coded_stream.h>
 
 #include <QEventLoop>
 #include <QFutureWatcher>
+#include <QMetaMethod>
 #include <QTcpSocket>
+#include <QTimer>
 
 #include <algorithm>
-#include <queue>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <optional>
+#include <vector>
 
 #include <QtDebug>
 #include <QLoggingCategory>
@@ -35,29 +50,6 @@ template<class... Ts> overloaded(Ts...) -> overloaded<Ts...>;
 
 using namespace DFHack;
 
-struct HandshakePacket
-{
-	static constexpr std::size_t MagicSize = 8;
-	static constexpr char RequestMagic[MagicSize] = {'D','F','H','a','c','k','?','\n'};
-	static constexpr char ReplyMagic[MagicSize] = {'D','F','H','a','c','k','!','\n'};
-
-	char magic[MagicSize];
-	int version;
-};
-
-struct MessageHeader
-{
-	static constexpr int16_t ReplyResult = -1;
-	static constexpr int16_t ReplyFail = -2;
-	static constexpr int16_t ReplyText = -3;
-	static constexpr int16_t RequestQuit = -4;
-
-	static constexpr int32_t MaxMessageSize = 64*1024*1024;
-
-	int16_t id;
-	int32_t size;
-};
-
 enum class State {
 	Disconnected,
 	Connecting,
@@ -68,30 +60,134 @@ enum class State {
 	Disconnecting,
 };
 
+/**
+ * Metrics of a single call, added to the method metrics when finished.
+ */
+struct call_stats_t {
+	MethodMetrics *method = nullptr; // unset if metrics are disabled
+	QMutex *mutex = nullptr; // protects method
+	std::chrono::steady_clock::time_point sent_at; // unset if not sent
+	std::chrono::nanoseconds queue_wait{0};
+	std::uint64_t request_bytes = 0;
+	std::uint64_t reply_bytes = 0;
+	std::uint64_t notification_bytes = 0;
+
+	void record(CommandResult cr)
+	{
+		bool sent = sent_at != std::chrono::steady_clock::time_point();
+		auto wire_time = std::chrono::steady_clock::now() - sent_at;
+		QMutexLocker lock(mutex);
+		auto index = static_cast<int>(cr) - MethodMetrics::MinResult;
+		if (index >= 0 && index < int(method->results.size()))
+			++method->results[index];
+		method->request_bytes += request_bytes;
+		method->reply_bytes += reply_bytes;
+		method->notification_bytes += notification_bytes;
+		if (sent) {
+			method->queue_wait.record(queue_wait);
+			method->wire_time.record(wire_time);
+		}
+	}
+};
+
 struct call_t {
 	std::variant<int, std::shared_ptr<Client::Binding>> id;
-	std::string in_msg;
+	std::string frame; // header (filled when sending) followed by input message
 	std::shared_ptr<google::protobuf::MessageLite> out_msg;
+	std::shared_ptr<Client::ReplyDecoder> decoder; // used instead of out_msg if set
 	QPromise<CallReply<>> result;
-	QPromise<TextNotification> notifications;
+	std::optional<QPromise<TextNotification>> notifications; // unset if not kept
+	std::shared_ptr<NotificationSink> notification_sink;
+	std::shared_ptr<CallCompletion> completion;
+	std::atomic<int> *queue_depth;
+	QDeadlineTimer deadline = QDeadlineTimer(QDeadlineTimer::Forever);
+	CallOptions::Priority priority = CallOptions::Priority::Normal;
+	std::chrono::steady_clock::time_point queued_at;
+	bool invalid_id = false; // the server rejected a speculative binding id
+	bool limited = true; // counts towards the pipeline depth
+	bool finished = false; // a timed out call stays in flight until its reply
+	bool started = false; // sent once, calls may be sent again after binding
+	call_stats_t stats;
 
 	call_t(std::variant<int, std::shared_ptr<Client::Binding>> &&id,
-	       std::string &&in,
-	       std::shared_ptr<google::protobuf::MessageLite> &&out)
+	       std::string &&frame,
+	       std::shared_ptr<google::protobuf::MessageLite> &&out,
+	       std::atomic<int> &depth)
 		: id(std::move(id))
-		, in_msg(std::move(in))
+		, frame(std::move(frame))
 		, out_msg(std::move(out))
+		, queue_depth(&depth)
 	{
+		++depth;
 	}
 
 	void finish(CommandResult cr)
 	{
+		if (finished)
+			return;
+		finished = true;
+		// Canceled calls keep canceled futures, so that they are not
+		// mistaken for failures or timeouts.
+		bool was_canceled = canceled();
+		if (stats.method && !was_canceled)
+			stats.record(cr);
 #ifdef DFHACK_CLIENT_QT_DEBUG
-		qCDebug(ClientLog) << "finished call" << static_cast<int>(cr);
+		qCDebug(ClientLog) << "finished call" << static_cast<int>(cr) << "canceled" << was_canceled;
 #endif
-		result.addResult(CallReply<>{cr, std::move(out_msg)});
+		--*queue_depth;
+		if (was_canceled)
+			result.future().cancel();
+		else
+			result.addResult(CallReply<>{cr, std::move(out_msg)});
 		result.finish();
-		notifications.finish();
+		if (notifications)
+			notifications->finish();
+		if (completion)
+			completion->complete(cr);
+	}
+
+	void start()
+	{
+		if (started)
+			return;
+		started = true;
+		result.start();
+		if (notifications)
+			notifications->start();
+		if (completion)
+			completion->start();
+	}
+
+	/**
+	 * Move the call out for finishing it, leaving in its place a finished
+	 * call that only waits for its reply.
+	 */
+	call_t detach()
+	{
+		call_t call = std::move(*this);
+		id = call.id;
+		limited = call.limited;
+		notifications.reset();
+		stats = {};
+		finished = true;
+		return call;
+	}
+
+	/**
+	 * The result future or the completion was canceled.
+	 */
+	bool canceled() const
+	{
+		return result.isCanceled() || (completion && completion->isCanceled());
+	}
+
+	/**
+	 * The call result is no longer wanted: its deadline expired or it
+	 * was canceled.
+	 */
+	bool abandoned() const
+	{
+		return finished || deadline.hasExpired() || canceled();
 	}
 };
 
@@ -111,6 +207,12 @@ static bool is_same_bind_request(const dfproto::CoreBindRequest &lhs,
 {
 	return bind_request_to_tuple(lhs) == bind_request_to_tuple(rhs);
 }
+// Only core methods have ids fixed when the connection is opened, plugin
+// method ids depend on the order plugins are first bound.
+static bool is_cacheable(const dfproto::CoreBindRequest &request)
+{
+	return request.plugin().empty();
+}
 
 enum class ReadStatus {
 	Partial,
@@ -120,23 +222,216 @@ enum class ReadStatus {
 
 struct Client::Private
 {
+	static constexpr std::size_t ReadChunkSize = 64*1024;
+
 	QTcpSocket socket;
 	State state = State::Disconnected;
-	qint64 bytes_read;
+	qint64 bytes_read; // of the handshake, the header or the payload
+	bool reply_failed = false; // a field of the current reply failed to parse
 	union {
 		HandshakePacket handshake;
 		MessageHeader header; // current message header
 		char packet_data[std::max(sizeof(HandshakePacket), sizeof(MessageHeader))];
 	};
-	QByteArray payload;
+	std::vector<char> read_buffer = std::vector<char>(ReadChunkSize);
 	dfproto::CoreTextNotification notification;
-	std::queue<call_t> call_queue;
+	struct lane_t
+	{
+		std::deque<call_t> calls; // calls waiting to be sent
+		// Statistics, read from any thread
+		std::atomic<int> depth = 0;
+		std::atomic<quint64> sent = 0;
+		std::atomic<std::int64_t> total_wait = 0; // in ns
+		std::atomic<std::int64_t> max_wait = 0; // in ns
+	};
+	static constexpr std::size_t PriorityCount = 3;
+	std::array<lane_t, PriorityCount> lanes; // one queue per priority class
+	int bulk_share = 8;
+	int sent_since_bulk = 0; // calls sent from other lanes while bulk calls waited
+	std::deque<call_t> in_flight; // sent calls waiting for their reply
+	std::shared_ptr<CaptureWriter> capture;
+	std::atomic<bool> metrics_enabled = false;
+	QMutex metrics_mutex;
+	// Entries are never removed, so that calls can keep pointers to them
+	std::map<ClientMetrics::MethodKey, MethodMetrics> method_metrics;
+	std::size_t limited_in_flight = 0; // in-flight calls counting towards pipeline_depth
+	std::size_t pipeline_depth = 1;
+	std::atomic<int> queue_depth = 0; // calls not finished yet
+	std::atomic<ReplyAllocation> reply_allocation = ReplyAllocation::Heap;
+	std::atomic<bool> notification_batching = false;
+	std::atomic<bool> recycle_on_timeout = false;
+	QTimer deadline_timer; // fires at next_deadline
+	QDeadlineTimer next_deadline;
 	QPromise<bool> connect_promise;
+	QString host;
+	quint16 port = 0;
+	bool low_delay = false;
 
 	std::map<dfproto::CoreBindRequest, std::shared_ptr<Binding>, bind_request_less> bindings;
 	QMutex bindings_mutex;
+	std::atomic<quint64> binding_generation = next_generation();
+
+	// Generations are unique across all clients, so that a new client
+	// allocated at the address of a destroyed one does not match its
+	// cached bindings.
+	static quint64 next_generation()
+	{
+		static std::atomic<quint64> generation = 0;
+		return ++generation;
+	}
+
+	// Protects binding cache related members, may be locked after
+	// bindings_mutex.
+	QMutex cache_mutex;
+	std::shared_ptr<BindingCache> binding_cache;
+	QString server; // "host:port" of the current connection
+	std::optional<BindingCache::ServerVersion> cache_version;
+	bool version_verified = false;
+	// Requests for bindings made from the cache (under bindings_mutex)
+	std::map<const Binding *, dfproto::CoreBindRequest> speculative_requests;
+
+	Private(QObject *parent)
+		: socket(parent)
+		, deadline_timer(parent)
+	{
+		deadline_timer.setSingleShot(true);
+	}
+
+	/**
+	 * Start the deadline timer if \p deadline is earlier than the one
+	 * it is waiting for.
+	 */
+	void armDeadline(const QDeadlineTimer &deadline)
+	{
+		if (deadline.isForever())
+			return;
+		if (deadline_timer.isActive() && !(deadline < next_deadline))
+			return;
+		next_deadline = deadline;
+		deadline_timer.start(std::chrono::milliseconds(std::max<qint64>(deadline.remainingTime(), 0)));
+	}
+
+	/**
+	 * Add \p call to the queue, or fail it if the socket is not
+	 * connected.
+	 */
+	void queue(call_t &&call)
+	{
+		if (socket.state() != QAbstractSocket::ConnectedState) {
+#ifdef DFHACK_CLIENT_QT_DEBUG
+			qCDebug(ClientLog) << "call with unconnected client";
+#endif
+			call.finish(CommandResult::LinkFailure);
+			return;
+		}
+#ifdef DFHACK_CLIENT_QT_DEBUG
+		visit(overloaded{
+			[](int id) {
+				qCDebug(ClientLog) << "queue RPC call with id" << id;
+			},
+			[](const std::shared_ptr<Binding> &binding) {
+				qCDebug(ClientLog) << "queue RPC call with binding";
+				qCDebug(ClientLog) << "finished:" << binding->result.isFinished();
+				qCDebug(ClientLog) << "id:" << binding->id;
+			}}, call.id);
+#endif
+		armDeadline(call.deadline);
+		call.queued_at = std::chrono::steady_clock::now();
+		if (metrics_enabled && !call.stats.method)
+			trackMetrics(call);
+		auto &l = lane(call.priority);
+		l.calls.push_back(std::move(call));
+		++l.depth;
+	}
+
+	void trackMetrics(call_t &call)
+	{
+		if (auto id = std::get_if<int>(&call.id); id && *id == MessageHeader::RequestQuit)
+			return;
+		auto key = visit(overloaded{
+			[](int id) -> ClientMetrics::MethodKey {
+				switch (id) {
+				case 0: return {"", "BindMethod"};
+				case 1: return {"", "RunCommand"};
+				default: return {"", "id" + std::to_string(id)};
+				}
+			},
+			[](const std::shared_ptr<Binding> &binding) -> ClientMetrics::MethodKey {
+				return {binding->plugin, binding->method};
+			}}, call.id);
+		QMutexLocker lock(&metrics_mutex);
+		call.stats.method = &method_metrics[key];
+		call.stats.mutex = &metrics_mutex;
+	}
+
+	lane_t &lane(CallOptions::Priority priority)
+	{
+		return lanes[static_cast<std::size_t>(priority)];
+	}
+
+	/**
+	 * Remove the call at \p it from \p lane, \p it is moved to the next
+	 * call.
+	 */
+	call_t take(lane_t &lane, std::deque<call_t>::iterator &it)
+	{
+		auto call = std::move(*it);
+		it = lane.calls.erase(it);
+		--lane.depth;
+		return call;
+	}
+
+	call_t takeFront(lane_t &lane)
+	{
+		auto it = lane.calls.begin();
+		return take(lane, it);
+	}
+
+	std::size_t queuedCalls() const
+	{
+		std::size_t count = 0;
+		for (const auto &lane: lanes)
+			count += lane.calls.size();
+		return count;
+	}
+
+	static void record_wait(lane_t &lane, const call_t &call)
+	{
+		auto wait = std::chrono::duration_cast<std::chrono::nanoseconds>(
+				std::chrono::steady_clock::now() - call.queued_at).count();
+		++lane.sent;
+		lane.total_wait += wait;
+		if (wait > lane.max_wait)
+			lane.max_wait = wait;
+	}
 
-	Private(QObject *parent): socket(parent) {}
+	/**
+	 * Parse the top-level fields of the current reply payload already
+	 * received into \p msg. bytes_read counts the payload bytes parsed.
+	 */
+	ReadStatus readFields(google::protobuf::MessageLite &msg)
+	{
+		while (bytes_read < header.size) {
+			auto remaining = header.size - bytes_read;
+			// Payloads already received whole are parsed at once
+			std::optional<qint64> size = remaining;
+			if (socket.bytesAvailable() < remaining)
+				size = next_field_size(socket, remaining);
+			if (!size || socket.bytesAvailable() < *size)
+				return ReadStatus::Partial;
+			SocketInputStream input(socket, *size, read_buffer, capture.get());
+			bool parsed;
+			{
+				google::protobuf::io::CodedInputStream coded(&input);
+				parsed = msg.MergePartialFromCodedStream(&coded);
+			}
+			input.skipRemaining();
+			bytes_read += *size;
+			if (!parsed)
+				return ReadStatus::Failed;
+		}
+		return ReadStatus::Completed;
+	}
 
 	ReadStatus read(char *data, qint64 size)
 	{
@@ -147,6 +442,8 @@ struct Client::Private
 			socket.close();
 			return ReadStatus::Failed;
 		}
+		if (capture && ret > 0)
+			capture->record(Capture::Event::Received, data+bytes_read, ret);
 		bytes_read += ret;
 		return bytes_read < size ? ReadStatus::Partial : ReadStatus::Completed;
 	}
@@ -156,6 +453,8 @@ struct Client::Private
 	}
 	bool write(const char *data, qint64 size)
 	{
+		if (capture)
+			capture->record(Capture::Event::Sent, data, size);
 		while (size > 0) {
 			qint64 r;
 			if (-1 == (r = socket.write(data, size))) {
@@ -171,6 +470,36 @@ struct Client::Private
 	}
 };
 
+NotificationBatch::NotificationBatch()
+{
+}
+
+NotificationBatch::NotificationBatch(const dfproto::CoreTextNotification &notification)
+{
+	if (notification.fragments_size() == 0)
+		return;
+	auto data = std::make_shared<Data>();
+	std::size_t length = 0;
+	for (const auto &fragment: notification.fragments())
+		length += fragment.text().size();
+	data->text.reserve(length);
+	data->offsets.reserve(notification.fragments_size() + 1);
+	data->colors.reserve(notification.fragments_size());
+	data->offsets.push_back(0);
+	for (const auto &fragment: notification.fragments()) {
+		data->text.append(fragment.text());
+		data->offsets.push_back(data->text.size());
+		data->colors.push_back(static_cast<Color>(fragment.color()));
+	}
+	d = std::move(data);
+}
+
+QString NotificationBatch::text(std::size_t i) const
+{
+	auto str = utf8(i);
+	return QString::fromUtf8(str.data(), str.size());
+}
+
 Client::Client(QObject *parent)
 	: QObject(parent)
 	, p(std::make_unique<Client::Private>(this))
@@ -183,6 +512,8 @@ Client::Client(QObject *parent)
 	        this, &Client::disconnected);
 	QObject::connect(&p->socket, &QAbstractSocket::errorOccurred,
 		this, &Client::error);
+	QObject::connect(&p->deadline_timer, &QTimer::timeout,
+		this, &Client::checkDeadlines);
 }
 
 Client::~Client()
@@ -191,7 +522,7 @@ Client::~Client()
 	if (p->state != State::Disconnected) {
 		// Disconnect and wait
 		moveToThread(QThread::currentThread());
-		auto [result, notifications] = enqueueCall(MessageHeader::RequestQuit, {}, nullptr);
+		auto [result, notifications] = enqueueCall(MessageHeader::RequestQuit, serialize_frame(dfproto::EmptyMessage()), nullptr);
 		QFutureWatcher<CallReply<>> watcher;
 		QEventLoop loop;
 		QObject::connect(&watcher, &QFutureWatcher<CommandResult>::finished,
@@ -212,6 +543,12 @@ QFuture<bool> Client::connect(const QString &host, quint16 port)
 			qCDebug(ClientLog) << "connecting to host";
 #endif
 			p->state = State::Connecting;
+			p->host = host;
+			p->port = port;
+			{
+				QMutexLocker lock(&p->cache_mutex);
+				p->server = QString("%1:%2").arg(host).arg(port);
+			}
 			p->connect_promise = std::move(promise);
 			p->connect_promise.start();
 			p->socket.connectToHost(host, port);
@@ -234,111 +571,352 @@ QFuture<bool> Client::connect(const QString &host, quint16 port)
 	return res;
 }
 
+void Client::setLowDelay(bool enabled)
+{
+	QMetaObject::invokeMethod(this, [this, enabled]() {
+		p->low_delay = enabled;
+		if (p->socket.state() == QAbstractSocket::ConnectedState)
+			p->socket.setSocketOption(QAbstractSocket::LowDelayOption, enabled ? 1 : 0);
+	});
+}
+
+int Client::queueDepth() const
+{
+	return p->queue_depth;
+}
+
+void Client::setReplyAllocation(ReplyAllocation allocation)
+{
+	p->reply_allocation = allocation;
+}
+
+Client::ReplyAllocation Client::replyAllocation() const
+{
+	return p->reply_allocation;
+}
+
+void Client::setNotificationBatching(bool enabled)
+{
+	p->notification_batching = enabled;
+}
+
+bool Client::notificationBatching() const
+{
+	return p->notification_batching;
+}
+
+void Client::setBulkShare(int calls)
+{
+	QMetaObject::invokeMethod(this, [this, calls]() {
+		p->bulk_share = std::max(calls, 0);
+		sendNextCall();
+	});
+}
+
+Client::QueueStats Client::queueStats(CallOptions::Priority priority) const
+{
+	const auto &lane = p->lane(priority);
+	return {
+		lane.depth,
+		lane.sent,
+		std::chrono::nanoseconds(lane.total_wait),
+		std::chrono::nanoseconds(lane.max_wait),
+	};
+}
+
+void Client::resetQueueStats()
+{
+	for (auto &lane: p->lanes) {
+		lane.sent = 0;
+		lane.total_wait = 0;
+		lane.max_wait = 0;
+	}
+}
+
+void Client::setCapture(std::shared_ptr<CaptureWriter> capture)
+{
+	QMetaObject::invokeMethod(this, [this, capture = std::move(capture)]() mutable {
+		p->capture = std::move(capture);
+	});
+}
+
+void Client::setMetricsEnabled(bool enabled)
+{
+	p->metrics_enabled = enabled;
+}
+
+bool Client::metricsEnabled() const
+{
+	return p->metrics_enabled;
+}
+
+ClientMetrics Client::metrics() const
+{
+	ClientMetrics metrics;
+	{
+		QMutexLocker lock(&p->metrics_mutex);
+		metrics.methods = p->method_metrics;
+	}
+	metrics.pending_calls = p->queue_depth;
+	for (std::size_t i = 0; i < p->lanes.size(); ++i)
+		metrics.queued[i] = p->lanes[i].depth;
+	return metrics;
+}
+
+void Client::resetMetrics()
+{
+	QMutexLocker lock(&p->metrics_mutex);
+	for (auto &[key, method]: p->method_metrics)
+		method = MethodMetrics();
+}
+
+void Client::setRecycleOnTimeout(bool enabled)
+{
+	p->recycle_on_timeout = enabled;
+}
+
+bool Client::recycleOnTimeout() const
+{
+	return p->recycle_on_timeout;
+}
+
+void Client::setPipelineDepth(int depth)
+{
+	QMetaObject::invokeMethod(this, [this, depth]() {
+		p->pipeline_depth = std::max(depth, 1);
+		sendNextCall();
+	});
+}
+
 QFuture<void> Client::disconnect()
 {
-	return enqueueCall(MessageHeader::RequestQuit, {}, nullptr).first
+	return enqueueCall(MessageHeader::RequestQuit, serialize_frame(dfproto::EmptyMessage()), nullptr).first
 		.then([](auto){});
 }
 
 std::pair<QFuture<CallReply<>>, QFuture<TextNotification>> Client::call(int16_t id,
 					const google::protobuf::MessageLite &in,
-					std::shared_ptr<google::protobuf::MessageLite> out)
+					std::shared_ptr<google::protobuf::MessageLite> out,
+					const CallOptions &options)
 {
-	return enqueueCall(id, in.SerializeAsString(), std::move(out));
+	return enqueueCall(id, serialize_frame(in), std::move(out), nullptr, options);
 }
 
 std::pair<QFuture<CallReply<>>, QFuture<TextNotification>> Client::call(std::shared_ptr<Binding> binding,
 					const google::protobuf::MessageLite &in,
-					std::shared_ptr<google::protobuf::MessageLite> out)
+					std::shared_ptr<google::protobuf::MessageLite> out,
+					const CallOptions &options)
+{
+	return enqueueCall(std::move(binding), serialize_frame(in), std::move(out), nullptr, options);
+}
+
+/**
+ * Finishes the result future of decoder calls directly from the call, so
+ * that canceling the future cancels the call.
+ */
+class ResultCompletion: public CallCompletion
+{
+public:
+	ResultCompletion(std::shared_ptr<CallCompletion> next)
+		: next(std::move(next))
+	{
+	}
+
+	QFuture<CommandResult> future() const { return promise.future(); }
+
+	void start() override
+	{
+		promise.start();
+		if (next)
+			next->start();
+	}
+
+	void complete(CommandResult cr) override
+	{
+		promise.addResult(cr);
+		promise.finish();
+		if (next)
+			next->complete(cr);
+	}
+
+	bool isCanceled() const override
+	{
+		return promise.isCanceled() || (next && next->isCanceled());
+	}
+
+private:
+	QPromise<CommandResult> promise;
+	std::shared_ptr<CallCompletion> next;
+};
+
+std::pair<QFuture<CommandResult>, QFuture<TextNotification>> Client::call(int16_t id,
+					const google::protobuf::MessageLite &in,
+					std::shared_ptr<ReplyDecoder> decoder,
+					const CallOptions &options)
 {
-	return enqueueCall(std::move(binding), in.SerializeAsString(), std::move(out));
+	auto completion = std::make_shared<ResultCompletion>(options.completion);
+	auto call_options = options;
+	call_options.completion = completion;
+	auto res = enqueueCall(id, serialize_frame(in), nullptr, std::move(decoder), call_options);
+	return {completion->future(), std::move(res.second)};
+}
+
+std::pair<QFuture<CommandResult>, QFuture<TextNotification>> Client::call(std::shared_ptr<Binding> binding,
+					const google::protobuf::MessageLite &in,
+					std::shared_ptr<ReplyDecoder> decoder,
+					const CallOptions &options)
+{
+	auto completion = std::make_shared<ResultCompletion>(options.completion);
+	auto call_options = options;
+	call_options.completion = completion;
+	auto res = enqueueCall(std::move(binding), serialize_frame(in), nullptr, std::move(decoder), call_options);
+	return {completion->future(), std::move(res.second)};
 }
 
 std::pair<QFuture<CallReply<>>, QFuture<TextNotification>> Client::enqueueCall(
 		std::variant<int, std::shared_ptr<Binding>> id,
-		std::string &&in,
-		std::shared_ptr<google::protobuf::MessageLite> &&out)
+		std::string &&frame,
+		std::shared_ptr<google::protobuf::MessageLite> &&out,
+		std::shared_ptr<ReplyDecoder> &&decoder,
+		const CallOptions &options,
+		bool limited)
 {
-	call_t call(std::move(id), std::move(in), std::move(out));
+	call_t call(std::move(id), std::move(frame), std::move(out), p->queue_depth);
+	call.decoder = std::move(decoder);
+	call.notification_sink = options.notification_sink;
+	call.completion = options.completion;
+	call.deadline = options.deadline;
+	call.priority = options.priority;
+	call.limited = limited;
 	auto result = call.result.future();
-	auto notifications = call.notifications.future();
+	QFuture<TextNotification> notifications;
+	if (options.keep_notifications) {
+		call.notifications.emplace();
+		notifications = call.notifications->future();
+	}
 	QMetaObject::invokeMethod(this, [this, call = std::move(call)]() mutable {
-			if (p->socket.state() != QAbstractSocket::ConnectedState) {
-#ifdef DFHACK_CLIENT_QT_DEBUG
-				qCDebug(ClientLog) << "call with unconnected client";
-#endif
-				call.finish(CommandResult::LinkFailure);
-				return;
-			}
-#ifdef DFHACK_CLIENT_QT_DEBUG
-			visit(overloaded{
-				[](int id) {
-					qCDebug(ClientLog) << "queue RPC call with id" << id;
-				},
-				[](const std::shared_ptr<Binding> &binding) {
-					qCDebug(ClientLog) << "queue RPC call with binding";
-					qCDebug(ClientLog) << "finished:" << binding->result.isFinished();
-					qCDebug(ClientLog) << "id:" << binding->id;
-				}}, call.id);
-#endif
-			p->call_queue.push(std::move(call));
-			if (p->state == State::Ready)
-				sendNextCall();
+			p->queue(std::move(call));
+			sendNextCall();
 		});
 	return {result, notifications};
 }
 
 void Client::sendNextCall()
 {
-	assert(p->socket.state() == QAbstractSocket::ConnectedState);
-	assert(p->state == State::Ready);
-	assert(!p->call_queue.empty());
-
-	auto &call = p->call_queue.front();
-	call.result.start();
-	call.notifications.start();
-
-	std::string msg;
-	MessageHeader hdr;
-	try {
-		int id = visit(overloaded{
-			[](int id) { return id; },
-			[](const std::shared_ptr<Binding> &binding) {
-				if (!binding->result.isValid())
-					throw CommandResult::LinkFailure;
-				auto cr = binding->result.result();
-				if (cr != CommandResult::Ok)
-					throw cr;
-				return binding->id;
+	using Priority = CallOptions::Priority;
+	bool sent = false;
+	while (p->state == State::Ready
+			|| p->state == State::WaitingForMessageHeader
+			|| p->state == State::WaitingForMessageContent) {
+		// Lanes are tried by priority and the first call that can be sent
+		// is sent. Bulk calls go first once they missed their share.
+		auto &bulk = p->lane(Priority::Bulk);
+		bool bulk_turn = p->bulk_share > 0 && !bulk.calls.empty()
+			&& p->sent_since_bulk >= p->bulk_share;
+		auto order = bulk_turn
+			? std::array{Priority::Bulk, Priority::Interactive, Priority::Normal}
+			: std::array{Priority::Interactive, Priority::Normal, Priority::Bulk};
+		bool progress = false;
+		for (auto priority: order) {
+			auto &lane = p->lane(priority);
+			if (lane.calls.empty())
+				continue;
+			if (lane.calls.front().abandoned()) {
+				// Expired or canceled before being sent, the call
+				// is not started.
+				auto call = p->takeFront(lane);
+				call.finish(CommandResult::Timeout);
+				progress = true;
+				break;
+			}
+			// Bind requests do not depend on anything, they are not
+			// limited by the pipeline depth so that a batch of bindings
+			// is sent at once.
+			if (lane.calls.front().limited && p->limited_in_flight >= p->pipeline_depth)
+				continue;
+			assert(p->socket.state() == QAbstractSocket::ConnectedState);
+
+			std::optional<int> id;
+			try {
+				id = visit(overloaded{
+					[](int id) -> std::optional<int> { return id; },
+					[](const std::shared_ptr<Binding> &binding) -> std::optional<int> {
+						if (!binding->result.isValid())
+							throw CommandResult::LinkFailure;
+						if (!binding->result.isFinished())
+							return std::nullopt; // the bind call is still in flight
+						auto cr = binding->result.result();
+						if (cr != CommandResult::Ok)
+							throw cr;
+						return binding->id;
+					}
+				}, lane.calls.front().id);
 			}
-		}, call.id);
+			catch (CommandResult cr) {
 #ifdef DFHACK_CLIENT_QT_DEBUG
-		qCDebug(ClientLog) << "send next call" << id;
+				qCDebug(ClientLog) << "failed to send next call" << QString::fromLocal8Bit(std::error_code(cr).message());
 #endif
-		if (id == MessageHeader::RequestQuit) {
-			hdr.id = MessageHeader::RequestQuit;
-			hdr.size = 0;
-			p->state = State::Disconnecting;
-			p->write(&hdr);
-			// The call will finish when disconnecting
-		}
-		else {
-			hdr.id = id;
-			hdr.size = static_cast<int32_t>(call.in_msg.size());
-			p->state = State::WaitingForMessageHeader;
-			p->write(&hdr);
-			p->write(call.in_msg.data(), call.in_msg.size());
-			p->bytes_read = 0;
-		}
-	}
-	catch (CommandResult cr) {
+				auto call = p->takeFront(lane);
+				call.start();
+				call.finish(cr);
+				progress = true;
+				break;
+			}
+			if (!id)
+				continue;
+			// The server closes the connection when quitting, so pending
+			// replies must be received and other lanes emptied first.
+			if (*id == MessageHeader::RequestQuit
+					&& (!p->in_flight.empty() || p->queuedCalls() > lane.calls.size()))
+				continue;
 #ifdef DFHACK_CLIENT_QT_DEBUG
-		qCDebug(ClientLog) << "failed to send next call" << QString::fromLocal8Bit(std::error_code(cr).message());
+			qCDebug(ClientLog) << "send next call" << *id << "priority" << static_cast<int>(priority);
 #endif
-		finishCall(cr);
-		if (!p->call_queue.empty())
-			sendNextCall();
+
+			auto call = p->takeFront(lane);
+			// Calls retried after binding are only counted once
+			if (!call.started) {
+				call.start();
+				Private::record_wait(lane, call);
+				if (call.stats.method) {
+					call.stats.sent_at = std::chrono::steady_clock::now();
+					call.stats.queue_wait = call.stats.sent_at - call.queued_at;
+					call.stats.request_bytes += call.frame.size();
+				}
+			}
+			if (priority == Priority::Bulk)
+				p->sent_since_bulk = 0;
+			else if (!bulk.calls.empty())
+				++p->sent_since_bulk;
+
+			set_frame_header(call.frame, *id);
+			// Header and message are written together, all the calls
+			// sent now are flushed after the loop instead of waiting for
+			// the next event loop write notification.
+			if (!p->write(call.frame.data(), call.frame.size())) {
+				call.finish(CommandResult::LinkFailure);
+				return;
+			}
+			sent = true;
+			if (*id == MessageHeader::RequestQuit) {
+				p->state = State::Disconnecting;
+				// The call will finish when disconnecting
+			}
+			else if (p->state == State::Ready) {
+				p->state = State::WaitingForMessageHeader;
+				p->bytes_read = 0;
+			}
+			if (call.limited)
+				++p->limited_in_flight;
+			p->in_flight.push_back(std::move(call));
+			progress = true;
+			break;
+		}
+		if (!progress)
+			break;
 	}
+	if (sent)
+		p->socket.flush();
 }
 
 void Client::readyRead()
@@ -352,11 +930,13 @@ void Client::readyRead()
 		switch (p->state) {
 		case State::Handshake: {
 			auto ret = p->read(p->packet_data, sizeof(HandshakePacket));
-			if (ret == ReadStatus::Failed)
+			if (ret == ReadStatus::Failed) {
 				finishConnection(false);
+				return;
+			}
 			if (ret == ReadStatus::Partial)
 				return;
-			if (!std::ranges::equal(p->handshake.magic, HandshakePacket::ReplyMagic)) {
+			if (!is_handshake_reply(p->handshake)) {
 				qCCritical(ClientLog) << "Handshake message mismatch" << QByteArray(p->handshake.magic, HandshakePacket::MagicSize);
 				p->state = State::Disconnected;
 				p->socket.close();
@@ -375,43 +955,137 @@ void Client::readyRead()
 			if (p->read(p->packet_data, sizeof(MessageHeader)) != ReadStatus::Completed)
 				return;
 			if (p->header.id == MessageHeader::ReplyFail) {
+				if (auto &call = p->in_flight.front(); call.stats.method)
+					call.stats.reply_bytes += sizeof(MessageHeader);
 				if (p->header.size < -3 || p->header.size > 3)
 					finishCall(CommandResult::LinkFailure);
 				else
 					finishCall(static_cast<CommandResult>(p->header.size));
 			}
+			else if (p->header.size < 0 || p->header.size > MessageHeader::MaxMessageSize) {
+				qCCritical(ClientLog) << "Invalid message size" << p->header.size;
+				p->state = State::Disconnected;
+				p->socket.close();
+				return;
+			}
 			else {
 				p->state = State::WaitingForMessageContent;
-				p->payload.resize(p->header.size);
 				p->bytes_read = 0;
+				p->reply_failed = false;
 			}
 			break;
 		}
 		case State::WaitingForMessageContent: {
-			auto &call = p->call_queue.front();
-			if (p->read(p->payload.data(), p->header.size) != ReadStatus::Completed)
+			auto &call = p->in_flight.front();
+			// Timed out or canceled calls discard their replies
+			bool wanted = !call.finished && !call.canceled();
+			bool reply = p->header.id == MessageHeader::ReplyResult;
+			if (reply && wanted && !call.decoder && !p->reply_failed) {
+				// Reply messages are parsed directly from the socket
+				// buffer, one top-level field at a time as they are
+				// received, so that large replies are not buffered whole.
+				if (p->bytes_read == 0)
+					call.out_msg->Clear();
+				auto status = p->readFields(*call.out_msg);
+				if (status == ReadStatus::Partial)
+					return;
+				p->reply_failed = status == ReadStatus::Failed;
+			}
+			auto remaining = p->header.size - p->bytes_read;
+			if (reply && (!wanted || p->reply_failed)) {
+				// Discarded as it is received
+				auto available = std::min(p->socket.bytesAvailable(), remaining);
+				SocketInputStream(p->socket, available, p->read_buffer, p->capture.get()).skipRemaining();
+				p->bytes_read += available;
+				if (available < remaining)
+					return;
+			}
+			// Decoders and notifications parse the whole payload at once
+			else if (p->socket.bytesAvailable() < remaining)
 				return;
+			if (call.stats.method) {
+				auto bytes = sizeof(MessageHeader) + p->header.size;
+				if (p->header.id == MessageHeader::ReplyText)
+					call.stats.notification_bytes += bytes;
+				else
+					call.stats.reply_bytes += bytes;
+			}
+			SocketInputStream input(p->socket, p->header.size - p->bytes_read, p->read_buffer, p->capture.get());
 			switch (p->header.id) {
-			case MessageHeader::ReplyResult:
-				if (!call.out_msg->ParseFromArray(p->payload.data(), p->payload.size()))
+			case MessageHeader::ReplyResult: {
+				bool parsed = true;
+				if (wanted) {
+					if (call.decoder) {
+						google::protobuf::io::CodedInputStream coded(&input);
+						parsed = call.decoder->decode(coded);
+					}
+					else
+						parsed = !p->reply_failed && call.out_msg->IsInitialized();
+				}
+				input.skipRemaining();
+				if (!parsed)
 					finishCall(CommandResult::LinkFailure);
 				else
 					finishCall(CommandResult::Ok);
 				break;
+			}
 			case MessageHeader::ReplyText: {
-				if (!p->notification.ParseFromArray(p->payload.data(), p->payload.size())) {
+				if (!p->notification.ParseFromZeroCopyStream(&input)) {
 					qCCritical(ClientLog) << "Failed to parse CoreTextNotification";
 				}
-				for (const auto &fragment: p->notification.fragments()) {
-					auto text = QString::fromStdString(fragment.text());
+				input.skipRemaining();
+				bool speculative = holds_alternative<std::shared_ptr<Binding>>(call.id)
+					&& get<std::shared_ptr<Binding>>(call.id)->speculative;
+				if (speculative) {
+					// The call will be retried after binding. This matches
+					// the text printed by ServerConnection::threadFn in
+					// DFHack's library/RemoteServer.cpp ("RPC call of
+					// invalid id %d"), checked against DFHack 50.x; it is
+					// unchanged since the 0.34 series.
+					auto fragments = p->notification.mutable_fragments();
+					for (int i = fragments->size()-1; i >= 0; --i) {
+						if (fragments->Get(i).text().starts_with("RPC call of invalid id")) {
+							call.invalid_id = true;
+							fragments->DeleteSubrange(i, 1);
+						}
+					}
+				}
+				if (call.notification_sink && wanted) {
+					for (const auto &fragment: p->notification.fragments())
+						call.notification_sink->write(static_cast<Color>(fragment.color()), fragment.text());
+				}
+				if (p->notification_batching) {
+					NotificationBatch batch(p->notification);
 #ifdef DFHACK_CLIENT_QT_DEBUG
-					qCDebug(ClientLog) << "DFHack notification:" << text;
+					qCDebug(ClientLog) << "DFHack notifications:" << batch.size() << "fragments";
 #endif
-					call.notifications.addResult(TextNotification {
-							static_cast<Color>(fragment.color()),
-							text
-						});
-					emit notification(static_cast<Color>(fragment.color()), text);
+					if (!batch.empty()) {
+						if (call.notifications) {
+							QList<TextNotification> texts;
+							texts.reserve(batch.size());
+							for (std::size_t i = 0; i < batch.size(); ++i)
+								texts.append(batch.at(i));
+							call.notifications->addResults(texts);
+						}
+						emit notificationsBatch(batch);
+					}
+				}
+				else {
+					// Only convert texts that are used
+					bool connected = isSignalConnected(QMetaMethod::fromSignal(&Client::notification));
+					if (call.notifications || connected) {
+						for (const auto &fragment: p->notification.fragments()) {
+							auto color = static_cast<Color>(fragment.color());
+							auto text = QString::fromStdString(fragment.text());
+#ifdef DFHACK_CLIENT_QT_DEBUG
+							qCDebug(ClientLog) << "DFHack notification:" << text;
+#endif
+							if (call.notifications)
+								call.notifications->addResult(TextNotification{color, text});
+							if (connected)
+								emit notification(color, text);
+						}
+					}
 				}
 				p->state = State::WaitingForMessageHeader;
 				p->bytes_read = 0;
@@ -419,6 +1093,7 @@ void Client::readyRead()
 			}
 			default:
 				qCCritical(ClientLog) << "Unknown message id in header";
+				input.skipRemaining();
 				finishCall(CommandResult::LinkFailure);
 			}
 			break;
@@ -431,8 +1106,7 @@ void Client::readyRead()
 			return;
 		}
 	}
-	if (!p->call_queue.empty())
-		sendNextCall();
+	sendNextCall();
 }
 
 void Client::connected()
@@ -441,9 +1115,12 @@ void Client::connected()
 	qCDebug(ClientLog) << "handshake";
 #endif
 
-	HandshakePacket packet;
-	std::ranges::copy(HandshakePacket::RequestMagic, packet.magic);
-	packet.version = 1;
+	if (p->low_delay)
+		p->socket.setSocketOption(QAbstractSocket::LowDelayOption, 1);
+	if (p->capture)
+		p->capture->record(Capture::Event::Connection);
+
+	auto packet = handshake_request();
 	p->write(&packet);
 	p->state = State::Handshake;
 	p->bytes_read = 0;
@@ -461,11 +1138,16 @@ void Client::disconnected()
 	p->state = State::Disconnected;
 	p->socket.close();
 	// cancel pending calls
-	while (!p->call_queue.empty()) {
-		auto &call = p->call_queue.front();
+	while (!p->in_flight.empty()) {
+		auto call = std::move(p->in_flight.front());
+		p->in_flight.pop_front();
 		call.finish(CommandResult::LinkFailure);
-		p->call_queue.pop();
 	}
+	for (auto &lane: p->lanes) {
+		while (!lane.calls.empty())
+			p->takeFront(lane).finish(CommandResult::LinkFailure);
+	}
+	p->limited_in_flight = 0;
 	invalidateBindings();
 	if (during_connection)
 		finishConnection(false);
@@ -485,6 +1167,8 @@ void Client::error(QAbstractSocket::SocketError error)
 
 void Client::finishConnection(bool success)
 {
+	if (success)
+		verifyServerVersion();
 	p->connect_promise.addResult(success);
 	p->connect_promise.finish();
 	if (success)
@@ -496,34 +1180,279 @@ void Client::finishCall(CommandResult result)
 #ifdef DFHACK_CLIENT_QT_DEBUG
 	qCDebug(ClientLog) << "call finished" << static_cast<int>(result);
 #endif
-	p->state = State::Ready;
-	auto call = std::move(p->call_queue.front());
-	p->call_queue.pop();
-	call.finish(result);
+	auto call = std::move(p->in_flight.front());
+	p->in_flight.pop_front();
+	if (call.limited)
+		--p->limited_in_flight;
+	if (p->in_flight.empty())
+		p->state = State::Ready;
+	else {
+		p->state = State::WaitingForMessageHeader;
+		p->bytes_read = 0;
+	}
+	if (call.invalid_id && result != CommandResult::Ok && !call.abandoned()) {
+		auto binding = get<std::shared_ptr<Binding>>(call.id);
+		qCWarning(ClientLog) << "Cached binding id" << binding->id << "is invalid, binding again";
+		call.id = rebind(binding);
+		call.invalid_id = false;
+		p->queue(std::move(call));
+	}
+	else
+		call.finish(result);
+	sendNextCall();
+}
+
+void Client::checkDeadlines()
+{
+	// Calls are finished after walking the queues, as their continuations
+	// may queue new calls.
+	std::vector<call_t> expired;
+	// Calls not sent yet are dropped without being started
+	for (auto &lane: p->lanes) {
+		for (auto it = lane.calls.begin(); it != lane.calls.end();) {
+			if (it->abandoned())
+				expired.push_back(p->take(lane, it));
+			else
+				++it;
+		}
+	}
+	// Sent calls finish now, their replies are discarded later
+	bool timed_out = false;
+	for (auto &call: p->in_flight) {
+		if (!call.finished && call.deadline.hasExpired()) {
+			expired.push_back(call.detach());
+			timed_out = true;
+		}
+	}
+	for (auto &call: expired)
+		call.finish(CommandResult::Timeout);
+	if (timed_out && p->recycle_on_timeout) {
+		recycleConnection();
+		return;
+	}
+	p->deadline_timer.stop();
+	for (const auto &lane: p->lanes)
+		for (const auto &call: lane.calls)
+			p->armDeadline(call.deadline);
+	for (const auto &call: p->in_flight)
+		if (!call.finished)
+			p->armDeadline(call.deadline);
+}
+
+void Client::recycleConnection()
+{
+	if (p->state == State::Disconnected || p->state == State::Disconnecting)
+		return;
+	qCWarning(ClientLog) << "Call timed out, reconnecting to" << p->host;
+	// disconnected fails the pending calls
+	p->state = State::Disconnecting;
+	p->socket.abort();
+	connect(p->host, p->port);
 }
 
 std::shared_ptr<Client::Binding> Client::getBinding(const dfproto::CoreBindRequest &request)
 {
+	return getBindings({&request, 1}).front();
+}
+
+std::vector<std::shared_ptr<Client::Binding>> Client::getBindings(std::span<const dfproto::CoreBindRequest> requests)
+{
+	std::vector<std::shared_ptr<Binding>> bindings;
+	bindings.reserve(requests.size());
+	std::vector<call_t> calls;
 	QMutexLocker lock(&p->bindings_mutex);
-	auto it = p->bindings.lower_bound(request);
-	if (it == p->bindings.end() || !is_same_bind_request(it->first, request)) {
-		it = p->bindings.emplace_hint(it, request, std::make_shared<Binding>());
-		it->second->result = call(0, it->first, std::make_shared<dfproto::CoreBindReply>())
-			.first.then([binding = it->second](CallReply<> res) {
-				if (res) {
-					const auto &reply = static_cast<const dfproto::CoreBindReply &>(*res);
-					binding->id = reply.assigned_id();
-				}
-				return res.cr;
-			});
+	for (const auto &request: requests) {
+		auto it = p->bindings.lower_bound(request);
+		if (it == p->bindings.end() || !is_same_bind_request(it->first, request)) {
+			std::optional<int> cached_id;
+			if (is_cacheable(request)) {
+				QMutexLocker lock(&p->cache_mutex);
+				if (p->binding_cache && p->cache_version)
+					cached_id = p->binding_cache->id(*p->cache_version, request);
+			}
+			it = p->bindings.emplace_hint(it, request, std::make_shared<Binding>());
+			it->second->plugin = request.plugin();
+			it->second->method = request.method();
+			if (cached_id) {
+				it->second->id = *cached_id;
+				it->second->speculative = true;
+				it->second->result = QtFuture::makeReadyFuture(CommandResult::Ok);
+				p->speculative_requests.emplace(it->second.get(), request);
+			}
+			else {
+				call_t call(0, serialize_frame(request),
+						std::make_shared<dfproto::CoreBindReply>(),
+						p->queue_depth);
+				call.limited = false;
+				// Calls of any priority may wait for the binding
+				call.priority = CallOptions::Priority::Interactive;
+				it->second->result = call.result.future().then([this, request, binding = it->second](CallReply<> res) {
+					if (res) {
+						const auto &reply = static_cast<const dfproto::CoreBindReply &>(*res);
+						binding->id = reply.assigned_id();
+						recordBinding(request, binding->id);
+					}
+					return res.cr;
+				});
+				calls.push_back(std::move(call));
+			}
+		}
+		bindings.push_back(it->second);
 	}
-	return it->second;
+	if (!calls.empty()) {
+		// Queue all bind calls in the same event so they are written
+		// together.
+		QMetaObject::invokeMethod(this, [this, calls = std::move(calls)]() mutable {
+			for (auto &call: calls)
+				p->queue(std::move(call));
+			sendNextCall();
+		});
+	}
+	return bindings;
+}
+
+QFuture<Client::BindFailures> Client::bindAll(std::span<const dfproto::CoreBindRequest> requests)
+{
+	auto bindings = getBindings(requests);
+	QList<QFuture<CommandResult>> results;
+	for (const auto &binding: bindings)
+		results.append(binding->result);
+	return QtFuture::whenAll(results.begin(), results.end()).then(
+		[requests = std::vector(requests.begin(), requests.end())](const QList<QFuture<CommandResult>> &results) {
+			BindFailures failures;
+			for (std::size_t i = 0; i < requests.size(); ++i) {
+				auto cr = results[i].result();
+				if (cr != CommandResult::Ok)
+					failures.append({requests[i], cr});
+			}
+			return failures;
+		});
 }
 
 void Client::invalidateBindings()
 {
 	QMutexLocker lock(&p->bindings_mutex);
+	p->binding_generation = Private::next_generation();
 	for (const auto &[req, ptr]: p->bindings)
 		ptr->result = {};
 	p->bindings.clear();
+	p->speculative_requests.clear();
+	QMutexLocker cache_lock(&p->cache_mutex);
+	p->cache_version.reset();
+	p->version_verified = false;
+}
+
+void Client::setBindingCache(std::shared_ptr<BindingCache> cache)
+{
+	QMutexLocker lock(&p->cache_mutex);
+	p->binding_cache = std::move(cache);
+}
+
+void Client::verifyServerVersion()
+{
+	{
+		QMutexLocker lock(&p->cache_mutex);
+		if (!p->binding_cache)
+			return;
+		// Speculate that the server was not updated since last time
+		p->cache_version = p->binding_cache->serverVersion(p->server);
+		p->version_verified = false;
+	}
+	static const auto requests = []() {
+		std::array<dfproto::CoreBindRequest, 2> requests;
+		for (auto &request: requests) {
+			request.set_input_msg(dfproto::EmptyMessage().GetTypeName());
+			request.set_output_msg(dfproto::StringMessage().GetTypeName());
+		}
+		requests[0].set_method("GetVersion");
+		requests[1].set_method("GetDFVersion");
+		return requests;
+	}();
+	auto bindings = getBindings(requests);
+	QList<QFuture<CallReply<>>> replies;
+	// The version check must not delay other calls
+	for (const auto &binding: bindings)
+		replies.append(enqueueCall(binding, serialize_frame(dfproto::EmptyMessage()),
+				std::make_shared<dfproto::StringMessage>(), nullptr, {}, false).first);
+	QtFuture::whenAll(replies.begin(), replies.end()).then(this, [this](const QList<QFuture<CallReply<>>> &replies) {
+		auto version = replies[0].result();
+		auto df_version = replies[1].result();
+		if (!version || !df_version) {
+			qCWarning(ClientLog) << "Failed to get server version, binding cache disabled";
+			QMutexLocker lock(&p->cache_mutex);
+			p->cache_version.reset();
+			return;
+		}
+		BindingCache::ServerVersion server_version = {
+			static_cast<const dfproto::StringMessage &>(*version).value(),
+			static_cast<const dfproto::StringMessage &>(*df_version).value(),
+		};
+		std::shared_ptr<BindingCache> cache;
+		bool changed;
+		{
+			QMutexLocker lock(&p->cache_mutex);
+			if (!p->binding_cache)
+				return;
+			cache = p->binding_cache;
+			changed = p->cache_version && *p->cache_version != server_version;
+			p->cache_version = server_version;
+			p->version_verified = true;
+			cache->setServerVersion(p->server, server_version);
+		}
+		QMutexLocker lock(&p->bindings_mutex);
+		if (changed) {
+			// Following calls will bind again or use ids cached for
+			// the actual version.
+			qCWarning(ClientLog) << "Server version changed, dropping cached bindings";
+			std::erase_if(p->bindings, [](const auto &entry) {
+				return entry.second->speculative;
+			});
+			p->binding_generation = Private::next_generation();
+		}
+		// Remember bindings made before the version was known
+		for (const auto &[request, binding]: p->bindings)
+			if (is_cacheable(request) && !binding->speculative && binding->ready())
+				cache->setId(server_version, request, binding->id);
+	});
+}
+
+void Client::recordBinding(const dfproto::CoreBindRequest &request, int id)
+{
+	if (!is_cacheable(request))
+		return;
+	QMutexLocker lock(&p->cache_mutex);
+	if (p->binding_cache && p->version_verified)
+		p->binding_cache->setId(*p->cache_version, request, id);
+}
+
+std::shared_ptr<Client::Binding> Client::rebind(const std::shared_ptr<Binding> &binding)
+{
+	dfproto::CoreBindRequest request;
+	{
+		QMutexLocker lock(&p->bindings_mutex);
+		auto it = p->speculative_requests.find(binding.get());
+		if (it == p->speculative_requests.end())
+			return binding; // the connection was lost
+		request = it->second;
+	}
+	{
+		QMutexLocker lock(&p->cache_mutex);
+		if (p->binding_cache && p->cache_version)
+			p->binding_cache->removeId(*p->cache_version, request);
+	}
+	{
+		QMutexLocker lock(&p->bindings_mutex);
+		auto it = p->bindings.find(request);
+		if (it != p->bindings.end() && it->second == binding) {
+			p->bindings.erase(it);
+			// Drop the binding from Function caches
+			p->binding_generation = Private::next_generation();
+		}
+	}
+	return getBinding(request);
+}
+
+quint64 Client::bindingGeneration() const
+{
+	return p->binding_generation.load(std::memory_order_acquire);
 }
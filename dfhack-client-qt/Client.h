@@ -20,15 +20,25 @@
 #define DFHACK_CLIENT_QT_DFHACK_CLIENT_H
 
 #include <QAbstractSocket>
+#include <QDeadlineTimer>
 #include <QMutex>
 #include <QObject>
 #include <QThread>
 #include <QFuture>
 
+#include <chrono>
+#include <memory>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
 #include <dfhack-client-qt/globals.h>
 #include <dfhack-client-qt/CommandResult.h>
 #include <dfhack-client-qt/CoreProtocol.pb.h>
 
+namespace google::protobuf::io { class CodedInputStream; }
+
 namespace DFHack
 {
 
@@ -54,6 +64,131 @@ enum class Color
 
 using TextNotification = std::pair<DFHack::Color, QString>;
 
+/**
+ * Text fragments from a single ReplyText frame.
+ *
+ * Texts are kept as UTF-8 in a single buffer and only converted to QString
+ * when \ref text is called. Copies share the same data.
+ *
+ * \see Client::setNotificationBatching
+ */
+class DFHACK_CLIENT_QT_EXPORT NotificationBatch
+{
+public:
+	NotificationBatch();
+	NotificationBatch(const dfproto::CoreTextNotification &notification);
+
+	std::size_t size() const { return d ? d->colors.size() : 0; }
+	bool empty() const { return size() == 0; }
+	Color color(std::size_t i) const { return d->colors[i]; }
+	/**
+	 * UTF-8 text of fragment \p i, valid as long as the batch (or a copy)
+	 * exists.
+	 */
+	std::string_view utf8(std::size_t i) const
+	{
+		return std::string_view(d->text).substr(d->offsets[i], d->offsets[i+1] - d->offsets[i]);
+	}
+	QString text(std::size_t i) const;
+	TextNotification at(std::size_t i) const { return {color(i), text(i)}; }
+
+private:
+	struct Data
+	{
+		std::string text;
+		std::vector<std::uint32_t> offsets; // size() + 1 offsets in text
+		std::vector<Color> colors;
+	};
+	std::shared_ptr<const Data> d;
+};
+
+class BindingCache;
+class CaptureWriter;
+class NotificationSink;
+struct ClientMetrics;
+
+/**
+ * Callback for the end of a call, without going through the call futures.
+ *
+ * \see CallOptions::completion
+ */
+class CallCompletion
+{
+public:
+	virtual ~CallCompletion() = default;
+	/**
+	 * Called in the client thread when the call is sent. Calls dropped
+	 * before being sent (expired or canceled) are not started.
+	 */
+	virtual void start() {}
+	/**
+	 * Called in the client thread when the call finishes, after its
+	 * futures. Also called for canceled calls, \p cr is then not
+	 * meaningful.
+	 */
+	virtual void complete(CommandResult cr) = 0;
+	/**
+	 * Checked by the client before sending the call and when its reply
+	 * arrives: a canceled call is dropped, or its reply discarded, and
+	 * its futures are left canceled without result.
+	 */
+	virtual bool isCanceled() const { return false; }
+};
+
+/**
+ * Per-call options.
+ *
+ * \see Client::call
+ */
+struct CallOptions
+{
+	/**
+	 * Receives the text fragments of the call as they arrive, in
+	 * the client thread.
+	 */
+	std::shared_ptr<NotificationSink> notification_sink;
+	/**
+	 * Keep text notifications in the future returned by the call.
+	 * If false, no notification promise is created and the
+	 * returned future is empty and canceled.
+	 */
+	bool keep_notifications = true;
+	/**
+	 * The call finishes with CommandResult::Timeout if it did not finish
+	 * before the deadline. A call still queued when the deadline
+	 * expires is dropped without being sent. A call already sent
+	 * finishes immediately and its reply is discarded when it arrives
+	 * (see Client::setRecycleOnTimeout).
+	 *
+	 * Default is no deadline.
+	 */
+	QDeadlineTimer deadline = QDeadlineTimer(QDeadlineTimer::Forever);
+
+	/**
+	 * Priority classes, each has its own queue.
+	 *
+	 * \see Client::setBulkShare
+	 */
+	enum class Priority
+	{
+		Interactive, ///< user actions
+		Normal,
+		Bulk, ///< background scans and refreshes
+	};
+	/**
+	 * Queued calls are sent from the highest priority class first.
+	 * Calls of the same class are sent in order.
+	 *
+	 * Default is Priority::Normal.
+	 */
+	Priority priority = Priority::Normal;
+	/**
+	 * Notified when the call finishes, directly from the client thread.
+	 * Used by coroutines awaiting Function::async.
+	 */
+	std::shared_ptr<CallCompletion> completion = nullptr;
+};
+
 /**
  * Reply to a function call
  *
@@ -140,6 +275,169 @@ public:
 	 */
 	QFuture<void> disconnect();
 
+	/**
+	 * Enable or disable TCP_NODELAY on the client socket
+	 *
+	 * Disabled by default. The setting is kept for later connections.
+	 */
+	void setLowDelay(bool enabled);
+
+	/**
+	 * Set the maximum number of calls sent without waiting for their
+	 * replies
+	 *
+	 * Default is 1: a call is only sent after the previous one finished.
+	 * Greater values let independent calls be sent back-to-back, replies
+	 * are matched in order. A call using a binding that is not resolved
+	 * yet still waits for the bind reply. Bind requests are not limited
+	 * by the depth.
+	 */
+	void setPipelineDepth(int depth);
+
+	/**
+	 * Guarantee bulk calls a minimum share of the connection.
+	 *
+	 * While CallOptions::Priority::Bulk calls are waiting, one is sent
+	 * after every \p calls calls sent from the other classes. 0 only
+	 * sends bulk calls when the other queues are empty or blocked.
+	 *
+	 * Default is 8.
+	 */
+	void setBulkShare(int calls);
+
+	/**
+	 * Statistics of a priority class queue.
+	 */
+	struct QueueStats
+	{
+		int depth; ///< calls waiting to be sent
+		quint64 sent; ///< calls sent
+		std::chrono::nanoseconds total_wait; ///< sum of the times from queuing to sending
+		std::chrono::nanoseconds max_wait;
+
+		std::chrono::nanoseconds meanWait() const
+		{
+			return sent == 0 ? std::chrono::nanoseconds(0) : total_wait / static_cast<std::int64_t>(sent);
+		}
+	};
+	/**
+	 * Statistics of the \p priority queue since the client was created
+	 * or the last \ref resetQueueStats (except depth that is the
+	 * current queue size).
+	 *
+	 * This is thread-safe.
+	 */
+	QueueStats queueStats(CallOptions::Priority priority) const;
+	void resetQueueStats();
+
+	/**
+	 * Record the traffic of the following connections to \p capture.
+	 *
+	 * Everything written and read on the socket is recorded with its
+	 * timing, from the handshake, until the capture is replaced or
+	 * removed with nullptr. Set it before connecting to record the
+	 * handshake. The capture can be replayed by the replay-server bench
+	 * tool.
+	 */
+	void setCapture(std::shared_ptr<CaptureWriter> capture);
+
+	/**
+	 * Collect metrics for each method: calls by result, bytes, queue
+	 * wait and wire time histograms.
+	 *
+	 * Only calls queued while metrics are enabled are counted. Default
+	 * is false. This is thread-safe.
+	 *
+	 * \see metrics
+	 */
+	void setMetricsEnabled(bool enabled);
+	bool metricsEnabled() const;
+	/**
+	 * Copy of the metrics collected so far, with the current queue
+	 * depths.
+	 *
+	 * This is thread-safe.
+	 */
+	ClientMetrics metrics() const;
+	/**
+	 * Clear the collected metrics. This is thread-safe.
+	 */
+	void resetMetrics();
+
+	/**
+	 * Reconnect when a call already sent exceeds its deadline.
+	 *
+	 * Replies come in order, so a slow reply delays every call sent
+	 * after it. When enabled, the connection is closed as soon as a sent
+	 * call times out, failing the other pending calls with
+	 * CommandResult::LinkFailure, and the client connects again to the
+	 * same server. Otherwise the late reply is read and discarded.
+	 *
+	 * Default is false. This is thread-safe.
+	 */
+	void setRecycleOnTimeout(bool enabled);
+	bool recycleOnTimeout() const;
+
+	/**
+	 * Number of calls that are queued or waiting for their reply.
+	 *
+	 * This is thread-safe.
+	 */
+	int queueDepth() const;
+
+	enum class ReplyAllocation
+	{
+		/**
+		 * Reply messages are allocated on the heap, each sub-message
+		 * and repeated field is allocated separately.
+		 */
+		Heap,
+		/**
+		 * Reply messages are allocated on a protobuf arena owned by the
+		 * reply. Sub-messages use the same arena, so parsing large
+		 * replies needs only a few allocations and freeing them is
+		 * cheap.
+		 */
+		Arena,
+	};
+	/**
+	 * Set how Function objects allocate reply messages for this client.
+	 *
+	 * Default is ReplyAllocation::Heap. This is thread-safe.
+	 */
+	void setReplyAllocation(ReplyAllocation allocation);
+	ReplyAllocation replyAllocation() const;
+
+	/**
+	 * Deliver each ReplyText frame as a batch.
+	 *
+	 * When enabled, the fragments of a frame are added to the call
+	 * notification future at once, and \ref notificationsBatch is emitted
+	 * once per frame instead of \ref notification for each fragment.
+	 *
+	 * Default is false. This is thread-safe.
+	 */
+	void setNotificationBatching(bool enabled);
+	bool notificationBatching() const;
+
+	/**
+	 * Use \p cache for binding core methods without waiting for bind
+	 * replies.
+	 *
+	 * When connecting, methods with ids cached for the last version seen
+	 * on the same server are called directly with those ids, while the
+	 * server version is checked. Calls made with an invalid cached id are
+	 * retried after binding the method. New bindings are added to the
+	 * cache once the server version is known.
+	 *
+	 * Cached ids are only valid if the server version did not change since
+	 * they were cached: the first calls after an update may reach the
+	 * wrong method. Only use a binding cache when this risk is acceptable.
+	 *
+	 * Takes effect on the next connection, nullptr disables the cache.
+	 */
+	void setBindingCache(std::shared_ptr<BindingCache> cache);
+
 	struct Binding
 	{
 		/**
@@ -153,6 +451,15 @@ public:
 		 * Result for the bind request.
 		 */
 		QFuture<CommandResult> result;
+		/**
+		 * The id comes from the binding cache and was not confirmed
+		 * by the server.
+		 */
+		bool speculative = false;
+		/**
+		 * Names from the bind request.
+		 */
+		std::string plugin, method;
 
 		/**
 		 * Check if reply is valid and can be used.
@@ -170,19 +477,61 @@ public:
 	 * connection is lost.
 	 */
 	std::shared_ptr<Binding> getBinding(const dfproto::CoreBindRequest &);
+	/**
+	 * Get bindings for all \p requests.
+	 *
+	 * Same as \ref getBinding, but the bind requests not already cached
+	 * are sent together.
+	 *
+	 * \returns bindings in the same order as \p requests.
+	 */
+	std::vector<std::shared_ptr<Binding>> getBindings(std::span<const dfproto::CoreBindRequest> requests);
+
+	/**
+	 * Bind requests that failed, with their result.
+	 */
+	using BindFailures = QList<std::pair<dfproto::CoreBindRequest, CommandResult>>;
+	/**
+	 * Bind all \p requests.
+	 *
+	 * Bind requests are sent back-to-back regardless of the pipeline
+	 * depth, so binding many methods costs about one round trip.
+	 *
+	 * \returns a future list of failed requests, empty if all methods
+	 * were bound successfully.
+	 */
+	QFuture<BindFailures> bindAll(std::span<const dfproto::CoreBindRequest> requests);
+	/**
+	 * Current generation of the binding cache.
+	 *
+	 * The value changes every time bindings are invalidated and is unique
+	 * among all clients: a binding obtained from \ref getBinding can be
+	 * reused without calling \ref getBinding again as long as the
+	 * generation read before getting it is unchanged.
+	 *
+	 * This is thread-safe.
+	 */
+	quint64 bindingGeneration() const;
 
 	/**
 	 * Low-level remote function call using known id
 	 *
 	 * Call function \p id with parameters \p in and stores results in \p out.
 	 *
+	 * Canceling the returned call reply future before the call is sent
+	 * drops the call. If it was already sent, the reply is not parsed.
+	 * Either way the future stays canceled. Futures derived with
+	 * QFuture::then do not propagate cancellation, the futures returned
+	 * by Function calls and decoder calls do.
+	 *
 	 * \returns a pair of future call reply and future text notifications.
 	 * If the call succeeds, \ref CallReply<>::msg will contain \p out.
 	 */
 	std::pair<QFuture<CallReply<>>, QFuture<TextNotification>> call(
 			int16_t id,
 			const google::protobuf::MessageLite &in,
-			std::shared_ptr<google::protobuf::MessageLite> out);
+			std::shared_ptr<google::protobuf::MessageLite> out,
+			const CallOptions &options = {});
 	/**
 	 * Low-level remote function call using binding
 	 *
@@ -196,7 +545,50 @@ public:
 	std::pair<QFuture<CallReply<>>, QFuture<TextNotification>> call(
 			std::shared_ptr<Binding> binding,
 			const google::protobuf::MessageLite &in,
-			std::shared_ptr<google::protobuf::MessageLite> out);
+			std::shared_ptr<google::protobuf::MessageLite> out,
+			const CallOptions &options = {});
+
+	/**
+	 * Custom decoder for reply messages, reading the wire format directly
+	 * instead of parsing a protobuf message.
+	 */
+	class ReplyDecoder
+	{
+	public:
+		virtual ~ReplyDecoder() = default;
+		/**
+		 * Decode a serialized reply message from \p input.
+		 *
+		 * \returns false if the message is invalid.
+		 */
+		virtual bool decode(google::protobuf::io::CodedInputStream &input) = 0;
+	};
+	/**
+	 * Low-level remote function call using known id and a custom reply
+	 * decoder
+	 *
+	 * Same as the other call overloads but the reply is decoded by
+	 * \p decoder.
+	 *
+	 * \returns a pair of future command result and future text
+	 * notifications.
+	 */
+	std::pair<QFuture<CommandResult>, QFuture<TextNotification>> call(
+			int16_t id,
+			const google::protobuf::MessageLite &in,
+			std::shared_ptr<ReplyDecoder> decoder,
+			const CallOptions &options = {});
+	/**
+	 * Low-level remote function call using binding and a custom reply
+	 * decoder
+	 *
+	 * \see call(int16_t, const google::protobuf::MessageLite &, std::shared_ptr<ReplyDecoder>, const CallOptions &)
+	 */
+	std::pair<QFuture<CommandResult>, QFuture<TextNotification>> call(
+			std::shared_ptr<Binding> binding,
+			const google::protobuf::MessageLite &in,
+			std::shared_ptr<ReplyDecoder> decoder,
+			const CallOptions &options = {});
 
 signals:
 	/**
@@ -211,6 +603,13 @@ signals:
 	 * Signal emitted when a text notification is received.
 	 */
 	void notification(DFHack::Color color, const QString &text);
+	/**
+	 * Signal emitted for each ReplyText frame instead of \ref notification
+	 * when notification batching is enabled.
+	 *
+	 * \see setNotificationBatching
+	 */
+	void notificationsBatch(const DFHack::NotificationBatch &batch);
 
 private:
 	struct Private;
@@ -218,8 +617,11 @@ private:
 
 	std::pair<QFuture<CallReply<>>, QFuture<TextNotification>> enqueueCall(
 			std::variant<int, std::shared_ptr<Binding>> id,
-			std::string &&in,
-			std::shared_ptr<google::protobuf::MessageLite> &&out);
+			std::string &&frame,
+			std::shared_ptr<google::protobuf::MessageLite> &&out,
+			std::shared_ptr<ReplyDecoder> &&decoder = nullptr,
+			const CallOptions &options = {},
+			bool limited = true);
 
 	void sendNextCall();
 
@@ -230,12 +632,18 @@ private:
 
 	void finishConnection(bool success);
 	void finishCall(CommandResult result);
+	void checkDeadlines();
+	void recycleConnection();
 
 	void invalidateBindings();
+	void verifyServerVersion();
+	void recordBinding(const dfproto::CoreBindRequest &request, int id);
+	std::shared_ptr<Binding> rebind(const std::shared_ptr<Binding> &binding);
 };
 
 } // namespace DFHack
 
 Q_DECLARE_METATYPE(DFHack::Color);
+Q_DECLARE_METATYPE(DFHack::NotificationBatch);
 
 #endif
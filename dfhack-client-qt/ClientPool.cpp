@@ -0,0 +1,90 @@
+/*
+ * Copyright 2023 Clement Vuchener
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <dfhack-client-qt/ClientPool.h>
+
+#include <algorithm>
+
+using namespace DFHack;
+
+ClientPool::Connection::Connection()
+{
+	client.moveToThread(&thread);
+	thread.start();
+}
+
+ClientPool::Connection::~Connection()
+{
+	// Disconnect from the client thread so that the client is not
+	// destroyed while connected.
+	client.disconnect().waitForFinished();
+	thread.quit();
+	thread.wait();
+}
+
+ClientPool::ClientPool(int size)
+{
+	connections.resize(std::max(size, 1));
+	for (auto &connection: connections)
+		connection = std::make_unique<Connection>();
+}
+
+ClientPool::~ClientPool()
+{
+}
+
+QFuture<bool> ClientPool::connect(const QString &host, quint16 port)
+{
+	QList<QFuture<bool>> futures;
+	for (const auto &connection: connections)
+		futures.append(connection->client.connect(host, port));
+	return all_true(futures);
+}
+
+QFuture<void> ClientPool::disconnect()
+{
+	QList<QFuture<void>> futures;
+	for (const auto &connection: connections)
+		futures.append(connection->client.disconnect());
+	return QtFuture::whenAll(futures.begin(), futures.end()).then([](auto){});
+}
+
+Client &ClientPool::client()
+{
+	// Start from a rotating index so that ties are spread between clients
+	auto n = connections.size();
+	auto start = next++ % n;
+	auto best = start;
+	int best_depth = connections[start]->client.queueDepth();
+	for (std::size_t i = 1; i < n && best_depth > 0; ++i) {
+		auto index = (start + i) % n;
+		int depth = connections[index]->client.queueDepth();
+		if (depth < best_depth) {
+			best = index;
+			best_depth = depth;
+		}
+	}
+	return connections[best]->client;
+}
+
+QFuture<bool> ClientPool::all_true(QList<QFuture<bool>> &futures)
+{
+	return QtFuture::whenAll(futures.begin(), futures.end()).then([](const QList<QFuture<bool>> &r) {
+		return std::ranges::all_of(r, [](const QFuture<bool> &f) { return f.result(); });
+	});
+}
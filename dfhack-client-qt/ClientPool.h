@@ -0,0 +1,117 @@
+/*
+ * Copyright 2023 Clement Vuchener
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef DFHACK_CLIENT_QT_DFHACK_CLIENT_POOL_H
+#define DFHACK_CLIENT_QT_DFHACK_CLIENT_POOL_H
+
+#include <dfhack-client-qt/Client.h>
+
+#include <QThread>
+
+#include <atomic>
+#include <memory>
+#include <vector>
+
+namespace DFHack
+{
+
+/**
+ * Several connections to the same DFHack server, each client running in
+ * its own thread.
+ *
+ * Calls made through the pool go to the client with the fewest unfinished
+ * calls. Bindings are per connection: each client binds a function the first
+ * time it is called on that client, \ref bind binds it on all of them.
+ */
+class DFHACK_CLIENT_QT_EXPORT ClientPool
+{
+public:
+	/**
+	 * Create a pool of \p size clients (at least one).
+	 */
+	ClientPool(int size);
+	/**
+	 * Disconnect all clients and stop their threads.
+	 */
+	~ClientPool();
+
+	/**
+	 * Connect all clients.
+	 *
+	 * \returns a future indicating if all clients are connected.
+	 */
+	QFuture<bool> connect(const QString &host, quint16 port);
+	/**
+	 * Disconnect all clients.
+	 */
+	QFuture<void> disconnect();
+
+	int size() const { return static_cast<int>(connections.size()); }
+	Client &client(int index) { return connections[index]->client; }
+
+	/**
+	 * Get the client with the fewest queued or in-flight calls.
+	 */
+	Client &client();
+
+	/**
+	 * Bind \p function on all clients.
+	 *
+	 * \returns a future boolean telling if all the bind operations were
+	 * successful.
+	 */
+	template <typename F>
+	QFuture<bool> bind(const F &function)
+	{
+		QList<QFuture<bool>> futures;
+		for (const auto &connection: connections)
+			futures.append(function.bind(connection->client));
+		return all_true(futures);
+	}
+
+	/**
+	 * Call \p function on the least busy client.
+	 *
+	 * \p options (priority, deadline, ...) are passed to the call.
+	 *
+	 * \see Function::operator()
+	 */
+	template <typename F>
+	auto call(const F &function, const typename F::InputMessage &in = {}, const CallOptions &options = {})
+	{
+		return function(client(), in, options);
+	}
+
+private:
+	struct Connection
+	{
+		Client client;
+		QThread thread;
+
+		Connection();
+		~Connection();
+	};
+	std::vector<std::unique_ptr<Connection>> connections;
+	std::atomic<unsigned int> next = 0;
+
+	static QFuture<bool> all_true(QList<QFuture<bool>> &futures);
+};
+
+} // namespace DFHack
+
+#endif
@@ -32,6 +32,8 @@ public:
 	{
 		using namespace std::literals;
 		switch (static_cast<CommandResult>(condition)) {
+		case CommandResult::Timeout:
+			return "Timeout"s;
 		case CommandResult::LinkFailure:
 			return "Link failure"s;
 		case CommandResult::NeedsConsole:
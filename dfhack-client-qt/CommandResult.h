@@ -28,6 +28,7 @@ namespace DFHack
 
 enum class CommandResult: int32_t
 {
+	Timeout = -4, ///< the call deadline expired (client-side only)
 	LinkFailure = -3,
 	NeedsConsole = -2,
 	NotImplemented = -1,
@@ -33,6 +33,16 @@ struct Core
 	const Function<dfproto::EmptyMessage, dfproto::IntMessage> resume = {"", "CoreResume"};
 
 	const Function<dfproto::CoreRunLuaRequest, dfproto::StringListMessage> runLua = {"", "RunLua"};
+
+	/**
+	 * Bind all the functions at once.
+	 *
+	 * \see DFHack::bindAll
+	 */
+	QFuture<Client::BindFailures> bindAll(Client &client) const
+	{
+		return DFHack::bindAll(client, suspend, resume, runLua);
+	}
 };
 
 } // namespace DFHack
@@ -0,0 +1,132 @@
+/*
+ * Copyright 2023 Clement Vuchener
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef DFHACK_CLIENT_QT_DFHACK_COROUTINE_H
+#define DFHACK_CLIENT_QT_DFHACK_COROUTINE_H
+
+#include <dfhack-client-qt/Client.h>
+
+#include <atomic>
+#include <coroutine>
+
+namespace DFHack
+{
+
+/**
+ * Awaitable result of a call started with Function::async.
+ *
+ * The call is sent when the awaitable is created, so several calls can
+ * be started before awaiting them. The result is delivered directly from
+ * the client call completion, without creating any future continuation.
+ *
+ * The awaiting coroutine is resumed in the client thread, or through the
+ * event loop of the context object given to \ref resumeOn. If the call
+ * already finished when awaited, the coroutine continues without being
+ * suspended.
+ *
+ * Coroutines returning a QFuture need FutureCoroutine.h.
+ *
+ * \code
+ * QFuture<bool> suspend_and_resume(DFHack::Client &client, DFHack::Core &core)
+ * {
+ *     auto suspended = co_await core.suspend.async(client);
+ *     if (!suspended)
+ *         co_return false;
+ *     co_return bool(co_await core.resume.async(client));
+ * }
+ * \endcode
+ */
+template <typename T>
+class CallAwaitable
+{
+public:
+	CallAwaitable(std::shared_ptr<T> out)
+		: state(std::make_shared<State>())
+		, out(std::move(out))
+	{
+	}
+
+	/**
+	 * Completion to pass in the CallOptions of the call.
+	 */
+	std::shared_ptr<CallCompletion> completion() const { return state; }
+	/**
+	 * Reply message to pass to the call.
+	 */
+	std::shared_ptr<T> reply() const { return out; }
+
+	/**
+	 * Resume the awaiting coroutine in the thread of \p context instead
+	 * of the client thread. \p context must still exist when the call
+	 * finishes.
+	 *
+	 * Must be called before awaiting.
+	 */
+	CallAwaitable &resumeOn(QObject *context)
+	{
+		state->context = context;
+		return *this;
+	}
+
+	bool await_ready() const noexcept
+	{
+		return state->stage.load(std::memory_order_acquire) == Finished;
+	}
+
+	bool await_suspend(std::coroutine_handle<> handle) noexcept
+	{
+		state->handle = handle;
+		int expected = Pending;
+		// Fails if the call finished in the meantime, continue without
+		// suspending.
+		return state->stage.compare_exchange_strong(expected, Awaiting,
+				std::memory_order_acq_rel);
+	}
+
+	CallReply<T> await_resume() noexcept
+	{
+		return {state->cr, std::move(out)};
+	}
+
+private:
+	enum Stage { Pending, Awaiting, Finished };
+	struct State: CallCompletion
+	{
+		std::atomic<int> stage = Pending;
+		CommandResult cr = CommandResult::LinkFailure;
+		std::coroutine_handle<> handle;
+		QObject *context = nullptr;
+
+		void complete(CommandResult cr) override
+		{
+			this->cr = cr;
+			if (stage.exchange(Finished, std::memory_order_acq_rel) != Awaiting)
+				return;
+			if (context)
+				QMetaObject::invokeMethod(context, [handle = handle]() { handle.resume(); });
+			else
+				handle.resume();
+		}
+	};
+	std::shared_ptr<State> state;
+	std::shared_ptr<T> out;
+};
+
+} // namespace DFHack
+
+#endif
@@ -0,0 +1,131 @@
+/*
+ * Copyright 2023 Clement Vuchener
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <dfhack-client-qt/Dictionaries.h>
+
+using namespace DFHack;
+
+Dictionaries::Dictionaries(Client &client, QObject *parent)
+	: QObject(parent)
+	, client(client)
+	, strings(1)
+	, qstrings(1)
+{
+	interned.emplace(strings.front(), 0);
+	connect(&client, &Client::connectionChanged, this, [this](bool connected) {
+		if (connected)
+			refresh();
+	});
+}
+
+Dictionaries::~Dictionaries()
+{
+}
+
+QFuture<CommandResult> Dictionaries::refresh()
+{
+	return basic.getDFVersion(client).first.then(this,
+		[this](CallReply<dfproto::StringMessage> version) {
+			if (!version)
+				return QtFuture::makeReadyFuture(version.cr);
+			if (loaded && version->value() == df_version)
+				return QtFuture::makeReadyFuture(CommandResult::Ok);
+			// Send both calls before waiting for the first reply
+			auto skills = basic.listJobSkills(client).first;
+			return basic.listEnums(client).first.then(this,
+				[this, skills, version = version->value()](CallReply<dfproto::ListEnumsOut> enums) mutable {
+					return skills.then(this,
+						[this, version, enums = std::move(enums)](CallReply<dfproto::ListJobSkillsOut> skills) {
+							if (!enums)
+								return enums.cr;
+							if (!skills)
+								return skills.cr;
+							build(*enums, *skills);
+							df_version = version;
+							loaded = true;
+							emit changed();
+							return CommandResult::Ok;
+						});
+				}).unwrap();
+		}).unwrap();
+}
+
+void Dictionaries::Table::set(int value, std::uint32_t id)
+{
+	if (ids.empty())
+		min = value;
+	else if (value < min) {
+		ids.insert(ids.begin(), min - value, 0);
+		min = value;
+	}
+	auto i = std::size_t(value - min);
+	if (i >= ids.size())
+		ids.resize(i + 1, 0);
+	ids[i] = id;
+}
+
+std::uint32_t Dictionaries::intern(const std::string &str)
+{
+	auto it = interned.find(str);
+	if (it != interned.end())
+		return it->second;
+	std::uint32_t id = strings.size();
+	// deque elements never move, views on them stay valid
+	const auto &stored = strings.emplace_back(str);
+	qstrings.push_back(QString::fromStdString(str));
+	interned.emplace(stored, id);
+	return id;
+}
+
+void Dictionaries::build(const dfproto::ListEnumsOut &list, const dfproto::ListJobSkillsOut &skills)
+{
+	const google::protobuf::RepeatedPtrField<dfproto::EnumItemName> *items[EnumCount] = {
+		&list.material_flags(),
+		&list.inorganic_flags(),
+		&list.unit_flags1(),
+		&list.unit_flags2(),
+		&list.unit_flags3(),
+		&list.unit_labor(),
+		&list.job_skill(),
+		&list.cie_add_tag_mask1(),
+		&list.cie_add_tag_mask2(),
+		&list.death_info_flags(),
+		&list.profession(),
+	};
+	for (std::size_t e = 0; e < EnumCount; ++e) {
+		Table table;
+		for (const auto &item: *items[e]) {
+			auto id = intern(item.name());
+			// Bitfield members cover bit_size bits from value
+			for (int i = 0; i < std::max(item.bit_size(), 1); ++i)
+				table.set(item.value() + i, id);
+		}
+		enums[e] = std::move(table);
+	}
+
+	Table skill_table, profession_table, labor_table;
+	for (const auto &skill: skills.skill())
+		skill_table.set(skill.id(), intern(skill.caption()));
+	for (const auto &profession: skills.profession())
+		profession_table.set(profession.id(), intern(profession.caption()));
+	for (const auto &labor: skills.labor())
+		labor_table.set(labor.id(), intern(labor.caption()));
+	captions[std::size_t(Caption::JobSkill)] = std::move(skill_table);
+	captions[std::size_t(Caption::Profession)] = std::move(profession_table);
+	captions[std::size_t(Caption::UnitLabor)] = std::move(labor_table);
+}
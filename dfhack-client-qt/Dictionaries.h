@@ -0,0 +1,181 @@
+/*
+ * Copyright 2023 Clement Vuchener
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef DFHACK_CLIENT_QT_DFHACK_DICTIONARIES_H
+#define DFHACK_CLIENT_QT_DFHACK_DICTIONARIES_H
+
+#include <QObject>
+#include <QString>
+
+#include <array>
+#include <bit>
+#include <deque>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include <dfhack-client-qt/Basic.h>
+
+namespace DFHack
+{
+
+/**
+ * Names of DF enums and skills from ListEnums and ListJobSkills.
+ *
+ * The dictionaries are loaded when the client connects and loaded again
+ * only if the DF version changed since the last load. Lookups are array
+ * accesses and do not allocate.
+ *
+ * Names are interned for the lifetime of the dictionaries: returned
+ * references stay valid after a reload.
+ *
+ * Dictionaries must be used from the thread they live in.
+ */
+class DFHACK_CLIENT_QT_EXPORT Dictionaries: public QObject
+{
+	Q_OBJECT
+public:
+	/**
+	 * Enums from ListEnumsOut.
+	 */
+	enum class Enum
+	{
+		MaterialFlags,
+		InorganicFlags,
+		UnitFlags1, ///< bitfield
+		UnitFlags2, ///< bitfield
+		UnitFlags3, ///< bitfield
+		UnitLabor,
+		JobSkill,
+		CieAddTagMask1, ///< bitfield
+		CieAddTagMask2, ///< bitfield
+		DeathInfoFlags, ///< bitfield
+		Profession,
+	};
+	static constexpr std::size_t EnumCount = 11;
+	/**
+	 * Captions from ListJobSkillsOut.
+	 */
+	enum class Caption
+	{
+		JobSkill,
+		Profession,
+		UnitLabor,
+	};
+	static constexpr std::size_t CaptionCount = 3;
+
+	Dictionaries(Client &client, QObject *parent = nullptr);
+	~Dictionaries() override;
+
+	/**
+	 * Load the dictionaries if the DF version changed (or they were never
+	 * loaded). Called automatically when the client connects.
+	 */
+	QFuture<CommandResult> refresh();
+
+	/**
+	 * \returns true once dictionaries were loaded.
+	 */
+	bool isLoaded() const { return loaded; }
+	/**
+	 * DF version of the loaded dictionaries.
+	 */
+	const std::string &dfVersion() const { return df_version; }
+
+	/**
+	 * Name of \p value in enum \p e (bit position for bitfields), empty if
+	 * unknown.
+	 */
+	std::string_view name(Enum e, int value) const
+	{
+		return strings[enums[std::size_t(e)].at(value)];
+	}
+	const QString &qtName(Enum e, int value) const
+	{
+		return qstrings[enums[std::size_t(e)].at(value)];
+	}
+	/**
+	 * Caption of skill, profession or labor \p id, empty if unknown.
+	 */
+	std::string_view caption(Caption c, int id) const
+	{
+		return strings[captions[std::size_t(c)].at(id)];
+	}
+	const QString &qtCaption(Caption c, int id) const
+	{
+		return qstrings[captions[std::size_t(c)].at(id)];
+	}
+
+	/**
+	 * Call `f(int bit, std::string_view name)` for each field of bitfield
+	 * \p e set in \p word. Fields with several bits are only reported once.
+	 */
+	template <typename F>
+	void forEachFlag(Enum e, std::uint32_t word, F &&f) const
+	{
+		const auto &table = enums[std::size_t(e)];
+		std::uint32_t previous = 0;
+		int previous_bit = -2;
+		for (; word != 0; word &= word - 1) {
+			int bit = std::countr_zero(word);
+			auto id = table.at(bit);
+			if (id != 0 && !(id == previous && bit == previous_bit + 1))
+				f(bit, std::string_view(strings[id]));
+			previous = id;
+			previous_bit = bit;
+		}
+	}
+
+signals:
+	/**
+	 * Emitted after the dictionaries were (re)loaded.
+	 */
+	void changed();
+
+private:
+	// Maps values to interned string ids (0 is the empty string)
+	struct Table
+	{
+		int min = 0;
+		std::vector<std::uint32_t> ids;
+
+		std::uint32_t at(int value) const
+		{
+			auto i = std::size_t(value - min);
+			return i < ids.size() ? ids[i] : 0;
+		}
+		void set(int value, std::uint32_t id);
+	};
+	std::uint32_t intern(const std::string &str);
+	void build(const dfproto::ListEnumsOut &enums, const dfproto::ListJobSkillsOut &skills);
+
+	Client &client;
+	Basic basic;
+	bool loaded = false;
+	std::string df_version;
+	std::array<Table, EnumCount> enums;
+	std::array<Table, CaptionCount> captions;
+	std::deque<std::string> strings;
+	std::deque<QString> qstrings;
+	std::unordered_map<std::string_view, std::uint32_t> interned;
+};
+
+} // namespace DFHack
+
+#endif
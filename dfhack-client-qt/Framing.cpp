@@ -0,0 +1,185 @@
+/*
+ * Copyright 2023 Clement Vuchener
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <dfhack-client-qt/Framing.h>
+#include <dfhack-client-qt/Capture.h>
+
+#include <google/protobuf/io/coded_stream.h>
+
+#include <QIODevice>
+
+#include <algorithm>
+#include <cstring>
+
+#include <QtDebug>
+#include <QLoggingCategory>
+Q_DECLARE_LOGGING_CATEGORY(ClientLog)
+
+using namespace DFHack;
+
+std::string DFHack::serialize_frame(const google::protobuf::MessageLite &in)
+{
+	std::string frame(sizeof(MessageHeader), '\0');
+	in.AppendToString(&frame);
+	return frame;
+}
+
+void DFHack::set_frame_header(std::string &frame, int16_t id)
+{
+	MessageHeader hdr;
+	hdr.id = id;
+	hdr.size = static_cast<int32_t>(frame.size() - sizeof(MessageHeader));
+	std::memcpy(frame.data(), &hdr, sizeof(MessageHeader));
+}
+
+HandshakePacket DFHack::handshake_request()
+{
+	HandshakePacket packet;
+	std::ranges::copy(HandshakePacket::RequestMagic, packet.magic);
+	packet.version = 1;
+	return packet;
+}
+
+bool DFHack::is_handshake_reply(const HandshakePacket &packet)
+{
+	return std::ranges::equal(packet.magic, HandshakePacket::ReplyMagic);
+}
+
+std::optional<qint64> DFHack::next_field_size(QIODevice &device, qint64 remaining)
+{
+	// Enough for a tag and a 64-bit varint
+	char data[16];
+	auto size = device.peek(data, std::min<qint64>(sizeof(data), remaining));
+	if (size <= 0)
+		return std::nullopt;
+	auto incomplete = [&]() -> std::optional<qint64> {
+		// A truncated tag or length is invalid once all the bytes it may
+		// use are there.
+		if (size < std::min<qint64>(sizeof(data), remaining))
+			return std::nullopt;
+		return remaining;
+	};
+	google::protobuf::io::CodedInputStream input(reinterpret_cast<const std::uint8_t *>(data), size);
+	auto tag = input.ReadTag();
+	if (tag == 0)
+		return incomplete();
+	qint64 field_size;
+	switch (tag & 7) {
+	case 0: { // varint
+		std::uint64_t value;
+		if (!input.ReadVarint64(&value))
+			return incomplete();
+		field_size = input.CurrentPosition();
+		break;
+	}
+	case 1: // fixed64
+		field_size = input.CurrentPosition() + 8;
+		break;
+	case 2: { // length-delimited
+		std::uint32_t length;
+		if (!input.ReadVarint32(&length))
+			return incomplete();
+		field_size = input.CurrentPosition() + qint64(length);
+		break;
+	}
+	case 5: // fixed32
+		field_size = input.CurrentPosition() + 4;
+		break;
+	default:
+		return remaining;
+	}
+	// Fields overflowing the payload fail when parsed
+	return std::min(field_size, remaining);
+}
+
+SocketInputStream::SocketInputStream(QIODevice &device, qint64 size, std::vector<char> &buffer, CaptureWriter *capture)
+	: device(device)
+	, remaining(size)
+	, buffer(buffer)
+	, capture(capture)
+{
+}
+
+SocketInputStream::~SocketInputStream()
+{
+}
+
+bool SocketInputStream::Next(const void **data, int *size)
+{
+	if (backed_up > 0) {
+		*data = buffer.data() + chunk_size - backed_up;
+		*size = backed_up;
+		position += backed_up;
+		backed_up = 0;
+		return true;
+	}
+	if (remaining == 0)
+		return false;
+	auto ret = device.read(buffer.data(), std::min<qint64>(remaining, buffer.size()));
+	if (ret <= 0) {
+		qCCritical(ClientLog) << "Failed to read data from socket";
+		return false;
+	}
+	if (capture)
+		capture->record(Capture::Event::Received, buffer.data(), ret);
+	remaining -= ret;
+	position += ret;
+	chunk_size = static_cast<int>(ret);
+	*data = buffer.data();
+	*size = chunk_size;
+	return true;
+}
+
+void SocketInputStream::BackUp(int count)
+{
+	backed_up = count;
+	position -= count;
+}
+
+bool SocketInputStream::Skip(int count)
+{
+	const void *data;
+	int size;
+	while (count > 0 && Next(&data, &size)) {
+		if (size > count) {
+			BackUp(size - count);
+			return true;
+		}
+		count -= size;
+	}
+	return count == 0;
+}
+
+int64_t SocketInputStream::ByteCount() const
+{
+	return position;
+}
+
+void SocketInputStream::skipRemaining()
+{
+	if (capture) {
+		// Skipped bytes must be captured too
+		const void *data;
+		int size;
+		while (remaining > 0 && Next(&data, &size))
+			;
+	}
+	else if (remaining > 0)
+		device.skip(remaining);
+	remaining = 0;
+}
@@ -0,0 +1,115 @@
+/*
+ * Copyright 2023 Clement Vuchener
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef DFHACK_CLIENT_QT_DFHACK_FRAMING_H
+#define DFHACK_CLIENT_QT_DFHACK_FRAMING_H
+
+/*
+ * Message framing shared by Client and BlockingClient. This header is not
+ * installed.
+ */
+
+#include <dfhack-client-qt/Protocol.h>
+
+#include <google/protobuf/io/zero_copy_stream.h>
+#include <google/protobuf/message_lite.h>
+
+#include <QtGlobal>
+
+#include <optional>
+#include <string>
+#include <vector>
+
+class QIODevice;
+
+namespace DFHack
+{
+
+class CaptureWriter;
+
+/**
+ * Serialize \p in after an empty header. The header and the message can then
+ * be sent with a single write without any intermediate copy. Small messages
+ * fit in the string inline storage and do not allocate.
+ */
+std::string serialize_frame(const google::protobuf::MessageLite &in);
+/**
+ * Fill the header of a frame from \ref serialize_frame.
+ */
+void set_frame_header(std::string &frame, int16_t id);
+
+/**
+ * Handshake packet sent by clients.
+ */
+HandshakePacket handshake_request();
+/**
+ * Checks the handshake packet replied by the server.
+ */
+bool is_handshake_reply(const HandshakePacket &packet);
+
+/**
+ * Size of the next top-level field in a message payload, decoded from the
+ * first bytes available from \p device without reading them.
+ *
+ * \p remaining is the size of the rest of the payload. Groups and invalid
+ * fields give \p remaining, so that the rest of the payload is parsed at
+ * once.
+ *
+ * \returns the field size, or std::nullopt if more data is needed for
+ * knowing it.
+ */
+std::optional<qint64> next_field_size(QIODevice &device, qint64 remaining);
+
+/**
+ * Input stream reading a message payload directly from the socket buffer.
+ *
+ * Data goes through a small reusable chunk buffer, so that no second buffer
+ * for the payload is needed. The data read must already be available from
+ * the socket, as protobuf parsing cannot be suspended. Large payloads are
+ * parsed one top-level field at a time (see \ref next_field_size), so that
+ * the socket only buffers the field being received.
+ */
+class SocketInputStream: public google::protobuf::io::ZeroCopyInputStream
+{
+public:
+	SocketInputStream(QIODevice &device, qint64 size, std::vector<char> &buffer, CaptureWriter *capture = nullptr);
+	~SocketInputStream() override;
+
+	bool Next(const void **data, int *size) override;
+	void BackUp(int count) override;
+	bool Skip(int count) override;
+	int64_t ByteCount() const override;
+
+	/**
+	 * Discard the part of the payload that was not parsed.
+	 */
+	void skipRemaining();
+
+private:
+	QIODevice &device;
+	qint64 remaining;
+	std::vector<char> &buffer;
+	CaptureWriter *capture;
+	int chunk_size = 0;
+	int backed_up = 0;
+	int64_t position = 0;
+};
+
+} // namespace DFHack
+
+#endif
@@ -19,7 +19,22 @@
 #ifndef DFHACK_CLIENT_QT_DFHACK_FUNCTION_H
 #define DFHACK_CLIENT_QT_DFHACK_FUNCTION_H
 
+#include <dfhack-client-qt/BlockingClient.h>
 #include <dfhack-client-qt/Client.h>
+#include <dfhack-client-qt/Coroutine.h>
+#include <dfhack-client-qt/MessagePool.h>
+
+#include <google/protobuf/arena.h>
+
+#include <QMutex>
+#include <QPromise>
+
+#include <array>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <memory>
+#include <vector>
 
 namespace DFHack
 {
@@ -53,6 +68,14 @@ public:
 		bind_request.set_plugin(this->module);
 	}
 
+	/**
+	 * Copy the function declaration, the binding cache is not copied.
+	 */
+	Function(const Function &other)
+		: Function(other.module, other.name)
+	{
+	}
+
 	/**
 	 * Create a message for input arguments.
 	 */
@@ -65,11 +88,58 @@ public:
 	 */
 	QFuture<bool> bind(Client &client) const requires (id == -1)
 	{
-		return getBinding(client)->result.then([](CommandResult cr) {
+		return binding(client)->result.then([](CommandResult cr) {
 			return cr == CommandResult::Ok;
 		});
 	}
 
+	/**
+	 * Bind request sent for binding this function.
+	 */
+	const dfproto::CoreBindRequest &bindRequest() const requires (id == -1)
+	{
+		return bind_request;
+	}
+
+	/**
+	 * Get the binding of this function for \p client, requesting it if
+	 * needed.
+	 *
+	 * The last bindings are cached in the Function object: as long as the
+	 * client binding generation is unchanged, getting them again only
+	 * costs an atomic load of the cache slot and does not lock anything
+	 * nor look up the client binding map.
+	 *
+	 * Replaced cache entries are freed by later replacements once they
+	 * have been retired for CacheGracePeriod, so a reconnecting client
+	 * does not grow the cache without bound.
+	 *
+	 * This is thread-safe.
+	 */
+	std::shared_ptr<Client::Binding> binding(Client &client) const requires (id == -1)
+	{
+		auto generation = client.bindingGeneration();
+		auto index = cache_slot(client);
+		auto entry = cache[index].load(std::memory_order_acquire);
+		if (entry && entry->client == &client && entry->generation == generation)
+			return entry->binding;
+		auto new_entry = std::make_unique<CacheEntry>(&client, generation,
+				client.getBinding(bind_request));
+		auto binding = new_entry->binding;
+		auto now = std::chrono::steady_clock::now();
+		QMutexLocker lock(&cache_mutex);
+		cache[index].store(new_entry.get(), std::memory_order_release);
+		if (cache_entries[index])
+			retired_entries.push_back({std::move(cache_entries[index]), now});
+		cache_entries[index] = std::move(new_entry);
+		// Readers only use an entry for a few instructions after loading
+		// it, so entries retired long enough ago are not read anymore.
+		std::erase_if(retired_entries, [now](const RetiredEntry &retired) {
+			return now - retired.time > CacheGracePeriod;
+		});
+		return binding;
+	}
+
 	/**
 	 * Call the function.
 	 *
@@ -83,49 +153,222 @@ public:
 	 * For a given Function object, \ref call must not be called again
 	 * before the previous call is finished.
 	 *
+	 * \p options may give a sink for streaming text notifications.
+	 *
 	 * \returns a pair of future command result and future text notifications,
 	 * if the command result is CommandResult::Ok, \ref out is ready.
 	 */
 	std::pair<QFuture<CallReply<OutputMessage>>, QFuture<TextNotification>>
-	operator()(Client &client, const InputMessage &in = {}) const
+	operator()(Client &client, const InputMessage &in = {}, const CallOptions &options = {}) const
+	{
+		return call(client, in, makeReply(client.replyAllocation()), options);
+	}
+
+	/**
+	 * Call the function using a reply message from \p pool.
+	 *
+	 * The reply message goes back to the pool when the CallReply (and any
+	 * copy of it) is destroyed. Repeatedly calling a function this way
+	 * reuses the same messages and their capacity.
+	 *
+	 * \see operator()(Client &, const InputMessage &, const CallOptions &)
+	 */
+	std::pair<QFuture<CallReply<OutputMessage>>, QFuture<TextNotification>>
+	operator()(Client &client, MessagePool<OutputMessage> &pool, const InputMessage &in = {}, const CallOptions &options = {}) const
+	{
+		return call(client, in, pool.acquire(), options);
+	}
+
+	/**
+	 * Call the function decoding the reply with \p decoder instead of
+	 * parsing an OutputMessage.
+	 *
+	 * \p decoder must understand the OutputMessage wire format, it is
+	 * filled when the result future finishes with CommandResult::Ok.
+	 */
+	std::pair<QFuture<CommandResult>, QFuture<TextNotification>>
+	operator()(Client &client, std::shared_ptr<Client::ReplyDecoder> decoder, const InputMessage &in = {}, const CallOptions &options = {}) const
 	{
-		std::pair<QFuture<CallReply<>>, QFuture<TextNotification>> res;
 		if constexpr (id == -1)
-			res = client.call(getBinding(client), in, std::make_shared<Out>());
+			return client.call(binding(client), in, std::move(decoder), options);
 		else
-			res = client.call(id, in, std::make_shared<Out>());
-		return {
-			res.first.then([](CallReply<> r) { return std::move(r).cast<OutputMessage>(); }),
-			res.second
-		};
+			return client.call(id, in, std::move(decoder), options);
+	}
+
+	/**
+	 * Call the function synchronously through a blocking client.
+	 *
+	 * \see BlockingClient::call
+	 */
+	CallReply<OutputMessage>
+	operator()(BlockingClient &client, const InputMessage &in = {}, const CallOptions &options = {}) const
+	{
+		auto out = std::make_shared<OutputMessage>();
+		CommandResult cr;
+		if constexpr (id == -1)
+			cr = client.call(bind_request, in, *out, options);
+		else
+			cr = client.call(id, in, *out, options);
+		return {cr, std::move(out)};
+	}
+
+	/**
+	 * Call the function synchronously through a blocking client and
+	 * decode the reply with \p decoder.
+	 */
+	CommandResult operator()(BlockingClient &client, Client::ReplyDecoder &decoder, const InputMessage &in = {}, const CallOptions &options = {}) const
+	{
+		if constexpr (id == -1)
+			return client.call(bind_request, in, decoder, options);
+		else
+			return client.call(id, in, decoder, options);
+	}
+
+	/**
+	 * Call the function from a coroutine: `co_await fn.async(client, in)`
+	 * gives the CallReply.
+	 *
+	 * The call is sent immediately. Awaiting it does not go through the
+	 * call future, see CallAwaitable for where the coroutine is resumed.
+	 * Text notifications are only available through
+	 * CallOptions::notification_sink.
+	 */
+	[[nodiscard]] CallAwaitable<OutputMessage>
+	async(Client &client, const InputMessage &in = {}, const CallOptions &options = {}) const
+	{
+		CallAwaitable<OutputMessage> awaitable(makeReply(client.replyAllocation()));
+		auto call_options = options;
+		call_options.keep_notifications = false;
+		call_options.completion = awaitable.completion();
+		if constexpr (id == -1)
+			client.call(binding(client), in, awaitable.reply(), call_options);
+		else
+			client.call(id, in, awaitable.reply(), call_options);
+		return awaitable;
 	}
 
 private:
-	std::shared_ptr<Client::Binding> getBinding(Client &client) const
+	/**
+	 * Finishes the typed reply future directly from the call, so that
+	 * canceling the future cancels the call.
+	 */
+	class ReplyCompletion: public CallCompletion
 	{
-		return client.getBinding(bind_request);
+	public:
+		ReplyCompletion(std::shared_ptr<OutputMessage> out, std::shared_ptr<CallCompletion> next)
+			: out(std::move(out))
+			, next(std::move(next))
+		{
+		}
+
+		QFuture<CallReply<OutputMessage>> future() const { return promise.future(); }
+
+		void start() override
+		{
+			promise.start();
+			if (next)
+				next->start();
+		}
+
+		void complete(CommandResult cr) override
+		{
+			promise.addResult(CallReply<OutputMessage>{cr, std::move(out)});
+			promise.finish();
+			if (next)
+				next->complete(cr);
+		}
+
+		bool isCanceled() const override
+		{
+			return promise.isCanceled() || (next && next->isCanceled());
+		}
+
+	private:
+		QPromise<CallReply<OutputMessage>> promise;
+		std::shared_ptr<OutputMessage> out;
+		std::shared_ptr<CallCompletion> next;
+	};
+
+	std::pair<QFuture<CallReply<OutputMessage>>, QFuture<TextNotification>>
+	call(Client &client, const InputMessage &in, std::shared_ptr<OutputMessage> &&out, const CallOptions &options) const
+	{
+		auto completion = std::make_shared<ReplyCompletion>(out, options.completion);
+		auto call_options = options;
+		call_options.completion = completion;
+		QFuture<TextNotification> notifications;
+		if constexpr (id == -1)
+			notifications = client.call(binding(client), in, std::move(out), call_options).second;
+		else
+			notifications = client.call(id, in, std::move(out), call_options).second;
+		return {completion->future(), notifications};
 	}
-};
 
-template <typename T>
-concept BindableFunction = requires (T f) {
-	{ f.bind() } -> std::same_as<QFuture<bool>>;
+	struct CacheEntry
+	{
+		const Client *client;
+		quint64 generation;
+		std::shared_ptr<Client::Binding> binding;
+	};
+	struct RetiredEntry
+	{
+		std::unique_ptr<CacheEntry> entry;
+		std::chrono::steady_clock::time_point time;
+	};
+	// A few slots so that functions shared by a ClientPool do not evict
+	// each other on every call.
+	static constexpr std::size_t CacheSlots = 8;
+	static constexpr auto CacheGracePeriod = std::chrono::seconds(1);
+	mutable std::array<std::atomic<const CacheEntry *>, CacheSlots> cache = {};
+	// Owners of the entries, protected by cache_mutex
+	mutable QMutex cache_mutex;
+	mutable std::array<std::unique_ptr<CacheEntry>, CacheSlots> cache_entries;
+	mutable std::vector<RetiredEntry> retired_entries;
+
+	static std::size_t cache_slot(const Client &client)
+	{
+		// Fibonacci hashing of the address, whose low bits are always
+		// zero with heap allocation alignment.
+		static_assert(std::has_single_bit(CacheSlots));
+		auto address = std::uint64_t(reinterpret_cast<std::uintptr_t>(&client));
+		return (address * 0x9e3779b97f4a7c15ull) >> (64 - std::countr_zero(CacheSlots));
+	}
+
+	static std::shared_ptr<OutputMessage> makeReply(Client::ReplyAllocation allocation)
+	{
+		if (allocation == Client::ReplyAllocation::Arena) {
+			google::protobuf::ArenaOptions options;
+			options.start_block_size = 4096;
+			options.max_block_size = 1024*1024;
+			auto arena = std::make_shared<google::protobuf::Arena>(options);
+			auto msg = google::protobuf::Arena::CreateMessage<OutputMessage>(arena.get());
+			// The reply pointer keeps the arena alive
+			return {std::move(arena), msg};
+		}
+		return std::make_shared<OutputMessage>();
+	}
 };
 
 /**
- * Bind all the functions passed as parameters.
+ * Bind all the functions passed as parameters on \p client.
+ *
+ * The bind requests are all sent at once. Functions with fixed ids are
+ * ignored.
+ *
+ * \returns a future list of bind requests that failed, empty if all the
+ * functions were bound successfully.
  *
- * \returns a future boolean indicating if all the functions where bound
- * successfully.
+ * \see Client::bindAll
  */
-template <BindableFunction... Fs>
-QFuture<bool> bindAll(Fs &&...functions)
+template <typename... Fs>
+QFuture<Client::BindFailures> bindAll(Client &client, const Fs &...functions)
 {
-	QList<QFuture<bool>> futures;
-	(futures.append(functions.bind()), ...);
-	return QtFuture::whenAll(futures.begin(), futures.end()).then([](const QList<QFuture<bool>> &r) {
-		return std::ranges::all_of(r, &QFuture<bool>::result<bool>);
-	});
+	std::vector<dfproto::CoreBindRequest> requests;
+	auto add_request = [&requests](const auto &function) {
+		if constexpr (requires { function.bindRequest(); })
+			requests.push_back(function.bindRequest());
+	};
+	(add_request(functions), ...);
+	return client.bindAll(requests);
 }
 
 }
@@ -0,0 +1,93 @@
+/*
+ * Copyright 2023 Clement Vuchener
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef DFHACK_CLIENT_QT_DFHACK_FUTURE_COROUTINE_H
+#define DFHACK_CLIENT_QT_DFHACK_FUTURE_COROUTINE_H
+
+/*
+ * Opt-in support for coroutines returning QFuture<T>.
+ *
+ * This header specializes std::coroutine_traits for QFuture, it is not
+ * included by the other headers of the library. Do not include it in
+ * code that also uses another coroutine integration for QFuture.
+ */
+
+#include <QFuture>
+#include <QPromise>
+
+#include <coroutine>
+#include <exception>
+
+namespace DFHack
+{
+
+/**
+ * Coroutine promise for coroutines returning a QFuture.
+ *
+ * The coroutine starts immediately and the future finishes with the value
+ * given to `co_return`, or with the exception escaping the coroutine.
+ */
+template <typename T>
+struct FuturePromiseBase
+{
+	QPromise<T> promise;
+
+	FuturePromiseBase() { promise.start(); }
+
+	QFuture<T> get_return_object() { return promise.future(); }
+	std::suspend_never initial_suspend() noexcept { return {}; }
+	std::suspend_never final_suspend() noexcept { return {}; }
+
+	void unhandled_exception()
+	{
+		promise.setException(std::current_exception());
+		promise.finish();
+	}
+};
+
+template <typename T>
+struct FuturePromise: FuturePromiseBase<T>
+{
+	void return_value(T value)
+	{
+		this->promise.addResult(std::move(value));
+		this->promise.finish();
+	}
+};
+
+template <>
+struct FuturePromise<void>: FuturePromiseBase<void>
+{
+	void return_void()
+	{
+		promise.finish();
+	}
+};
+
+} // namespace DFHack
+
+/**
+ * Allow coroutines returning QFuture<T>.
+ */
+template <typename T, typename... Args>
+struct std::coroutine_traits<QFuture<T>, Args...>
+{
+	using promise_type = DFHack::FuturePromise<T>;
+};
+
+#endif
@@ -0,0 +1,164 @@
+/*
+ * Copyright 2023 Clement Vuchener
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <dfhack-client-qt/LaborWriter.h>
+
+#include <QTimer>
+
+using namespace DFHack;
+
+int LaborWriter::KnownLabors::get(int labor) const
+{
+	if (labor < 0)
+		return -1;
+	if (std::size_t(labor) < values.size())
+		return values[labor];
+	return complete ? 0 : -1;
+}
+
+void LaborWriter::KnownLabors::set(int labor, bool value)
+{
+	if (labor < 0)
+		return;
+	if (std::size_t(labor) >= values.size())
+		values.resize(labor + 1, complete ? 0 : -1);
+	values[labor] = value;
+}
+
+LaborWriter::LaborWriter(Client &client, QObject *parent)
+	: QObject(parent)
+	, client(client)
+{
+}
+
+LaborWriter::~LaborWriter()
+{
+	for (auto &[key, p]: pending) {
+		p.promise.addResult(CommandResult::LinkFailure);
+		p.promise.finish();
+	}
+}
+
+void LaborWriter::setWindow(std::chrono::milliseconds window)
+{
+	QMutexLocker lock(&mutex);
+	flush_window = window;
+}
+
+std::chrono::milliseconds LaborWriter::window() const
+{
+	QMutexLocker lock(&mutex);
+	return flush_window;
+}
+
+QFuture<CommandResult> LaborWriter::set(int unit_id, int labor, bool value)
+{
+	QMutexLocker lock(&mutex);
+	auto [it, inserted] = pending.try_emplace(make_key(unit_id, labor));
+	auto &p = it->second;
+	if (inserted) {
+		p.promise.start();
+		p.future = p.promise.future();
+	}
+	p.value = value; // only the last value is sent
+	if (!flush_queued) {
+		flush_queued = true;
+		QMetaObject::invokeMethod(this, [this]() {
+			QTimer::singleShot(window(), this, [this]() { flush(); });
+		}, Qt::QueuedConnection);
+	}
+	return p.future;
+}
+
+QFuture<CommandResult> LaborWriter::flush()
+{
+	std::unordered_map<Key, Pending> batch;
+	dfproto::SetUnitLaborsIn in;
+	{
+		QMutexLocker lock(&mutex);
+		flush_queued = false;
+		batch.swap(pending);
+		for (auto it = batch.begin(); it != batch.end();) {
+			int unit_id = std::int32_t(it->first >> 32);
+			int labor = std::int32_t(it->first & 0xffffffffu);
+			auto unit = known.find(unit_id);
+			// The known value is outdated while another change is
+			// in flight.
+			if (!in_flight.contains(it->first) && unit != known.end()
+					&& unit->second.get(labor) == int(it->second.value)) {
+				// No-op change
+				it->second.promise.addResult(CommandResult::Ok);
+				it->second.promise.finish();
+				it = batch.erase(it);
+				continue;
+			}
+			auto change = in.add_change();
+			change->set_unit_id(unit_id);
+			change->set_labor(labor);
+			change->set_value(it->second.value);
+			++in_flight[it->first];
+			++it;
+		}
+	}
+	if (batch.empty())
+		return QtFuture::makeReadyFuture(CommandResult::Ok);
+	CallOptions options;
+	options.priority = CallOptions::Priority::Interactive;
+	return basic.setUnitLabors(client, in, options).first.then(this,
+		[this, in = std::move(in), batch = std::move(batch)](CallReply<dfproto::EmptyMessage> reply) mutable {
+			{
+				QMutexLocker lock(&mutex);
+				for (const auto &[key, p]: batch)
+					if (auto it = in_flight.find(key); --it->second == 0)
+						in_flight.erase(it);
+				// Units not listed yet get a partial entry, with only
+				// the labors written.
+				if (reply)
+					for (const auto &change: in.change())
+						known[change.unit_id()].set(change.labor(), change.value());
+			}
+			for (auto &[key, p]: batch) {
+				p.promise.addResult(reply.cr);
+				p.promise.finish();
+			}
+			return reply.cr;
+		});
+}
+
+void LaborWriter::updateKnown(const dfproto::ListUnitsOut &units)
+{
+	QMutexLocker lock(&mutex);
+	for (const auto &unit: units.value()) {
+		auto &labors = known[unit.unit_id()];
+		labors.values.clear();
+		labors.complete = true;
+		for (int labor: unit.labors())
+			labors.set(labor, true);
+	}
+}
+
+void LaborWriter::clearKnown()
+{
+	QMutexLocker lock(&mutex);
+	known.clear();
+}
+
+LaborWriter::Key LaborWriter::make_key(int unit_id, int labor)
+{
+	return (Key(std::uint32_t(unit_id)) << 32) | std::uint32_t(labor);
+}
@@ -0,0 +1,131 @@
+/*
+ * Copyright 2023 Clement Vuchener
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef DFHACK_CLIENT_QT_DFHACK_LABOR_WRITER_H
+#define DFHACK_CLIENT_QT_DFHACK_LABOR_WRITER_H
+
+#include <QMutex>
+#include <QObject>
+
+#include <chrono>
+#include <unordered_map>
+
+#include <dfhack-client-qt/Basic.h>
+
+namespace DFHack
+{
+
+/**
+ * Batches labor changes in SetUnitLabors calls.
+ *
+ * Changes are collected for a time window and sent together in a single
+ * call. Changing the same labor of the same unit several times before the
+ * batch is sent only sends the last value, and changes to the value the
+ * labor is known to have are not sent at all, unless a previous change of
+ * the same labor is still being sent.
+ *
+ * Known labors come from the replies given to \ref updateKnown and from
+ * previous successful calls.
+ *
+ * All methods are thread-safe.
+ */
+class DFHACK_CLIENT_QT_EXPORT LaborWriter: public QObject
+{
+	Q_OBJECT
+public:
+	LaborWriter(Client &client, QObject *parent = nullptr);
+	~LaborWriter() override;
+
+	/**
+	 * Time changes are collected before sending them. With the default
+	 * window of 0, changes are sent once the writer thread event loop
+	 * runs.
+	 */
+	void setWindow(std::chrono::milliseconds window);
+	std::chrono::milliseconds window() const;
+
+	/**
+	 * Set \p labor of unit \p unit_id to \p value in the next batch.
+	 *
+	 * \returns a future result of the call that sends the change. It is Ok
+	 * without calling anything if the change was dropped as a no-op. When
+	 * the same labor is changed again before sending, both futures get the
+	 * same result.
+	 */
+	QFuture<CommandResult> set(int unit_id, int labor, bool value);
+	QFuture<CommandResult> set(const dfproto::UnitLaborState &change)
+	{
+		return set(change.unit_id(), change.labor(), change.value());
+	}
+
+	/**
+	 * Send the pending changes now.
+	 *
+	 * The call has the CallOptions::Priority::Interactive priority.
+	 *
+	 * \returns the future result of the call, Ok if there was nothing to
+	 * send.
+	 */
+	QFuture<CommandResult> flush();
+
+	/**
+	 * Record labors from ListUnits replies (requested with mask.labors).
+	 * Units from \p units have all their labors replaced.
+	 */
+	void updateKnown(const dfproto::ListUnitsOut &units);
+	/**
+	 * Forget known labors, all the following changes will be sent.
+	 */
+	void clearKnown();
+
+private:
+	using Key = std::uint64_t;
+	static Key make_key(int unit_id, int labor);
+
+	struct Pending
+	{
+		bool value;
+		QPromise<CommandResult> promise;
+		QFuture<CommandResult> future;
+	};
+
+	Client &client;
+	Basic basic;
+	mutable QMutex mutex;
+	std::chrono::milliseconds flush_window{0};
+	bool flush_queued = false;
+	std::unordered_map<Key, Pending> pending;
+	// Number of sent calls waiting for their reply for each change
+	std::unordered_map<Key, int> in_flight;
+
+	struct KnownLabors
+	{
+		// -1 for unknown, or labor value
+		std::vector<std::int8_t> values;
+		// labors from a ListUnits reply: missing labors are disabled
+		bool complete = false;
+
+		int get(int labor) const;
+		void set(int labor, bool value);
+	};
+	std::unordered_map<int, KnownLabors> known;
+};
+
+} // namespace DFHack
+
+#endif
@@ -0,0 +1,227 @@
+/*
+ * Copyright 2023 Clement Vuchener
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <dfhack-client-qt/MaterialCache.h>
+
+#include <bit>
+
+using namespace DFHack;
+
+static constexpr std::size_t InitialCapacity = 1024; // power of two
+
+static std::size_t slot_hash(std::uint64_t key, std::size_t capacity)
+{
+	// Fibonacci hashing, capacity is a power of two
+	return (key * 0x9e3779b97f4a7c15ull) >> (64 - std::countr_zero(capacity));
+}
+
+MaterialCache::MaterialCache(Client &client, QObject *parent)
+	: QObject(parent)
+	, client(client)
+	, table(InitialCapacity)
+{
+}
+
+MaterialCache::~MaterialCache()
+{
+	for (auto &[key, p]: pending) {
+		p.promise.addResult(nullptr);
+		p.promise.finish();
+	}
+}
+
+void MaterialCache::setStateMask(const dfproto::BasicMaterialInfoMask &mask)
+{
+	QMutexLocker lock(&mutex);
+	state_mask.Clear();
+	state_mask.mutable_states()->CopyFrom(mask.states());
+	if (mask.has_temperature())
+		state_mask.set_temperature(mask.temperature());
+	table.assign(InitialCapacity, {});
+	used_slots = 0;
+	++generation;
+}
+
+QFuture<MaterialCache::MaterialPtr> MaterialCache::get(int type, int index, Details details)
+{
+	auto key = make_key(type, index);
+	QMutexLocker lock(&mutex);
+	auto slot = findSlot(key);
+	if (slot && (slot->details & details) == details)
+		return QtFuture::makeReadyFuture(slot->material);
+	auto [it, inserted] = pending.try_emplace(key);
+	auto &p = it->second;
+	if (inserted) {
+		p.promise.start();
+		p.future = p.promise.future();
+	}
+	// Keep the details of the entry being upgraded
+	p.details |= details;
+	if (slot)
+		p.details |= slot->details;
+	if (!flush_queued) {
+		flush_queued = true;
+		QMetaObject::invokeMethod(this, &MaterialCache::flush, Qt::QueuedConnection);
+	}
+	return p.future;
+}
+
+MaterialCache::MaterialPtr MaterialCache::find(int type, int index, Details details) const
+{
+	QMutexLocker lock(&mutex);
+	auto slot = findSlot(make_key(type, index));
+	if (slot && (slot->details & details) == details)
+		return slot->material;
+	return nullptr;
+}
+
+std::size_t MaterialCache::size() const
+{
+	QMutexLocker lock(&mutex);
+	return used_slots;
+}
+
+void MaterialCache::clear()
+{
+	QMutexLocker lock(&mutex);
+	table.assign(InitialCapacity, {});
+	used_slots = 0;
+	++generation;
+}
+
+MaterialCache::Key MaterialCache::make_key(int type, int index)
+{
+	return (Key(std::uint32_t(type)) << 32) | std::uint32_t(index);
+}
+
+void MaterialCache::flush()
+{
+	std::unordered_map<Key, Pending> batch;
+	dfproto::ListMaterialsIn in;
+	Details details;
+	quint64 generation;
+	{
+		QMutexLocker lock(&mutex);
+		flush_queued = false;
+		generation = this->generation;
+		batch.swap(pending);
+		*in.mutable_mask() = state_mask;
+	}
+	if (batch.empty())
+		return;
+	in.mutable_id_list()->Reserve(batch.size());
+	for (const auto &[key, p]: batch) {
+		auto id = in.add_id_list();
+		id->set_type(std::int32_t(key >> 32));
+		id->set_index(std::int32_t(key & 0xffffffffu));
+		details |= p.details;
+	}
+	in.mutable_mask()->set_flags(details.testFlag(Detail::Flags));
+	in.mutable_mask()->set_reaction(details.testFlag(Detail::Reaction));
+	basic.listMaterials(client, in).first.then(this,
+		[this, details, generation, batch = std::move(batch)](CallReply<dfproto::ListMaterialsOut> reply) mutable {
+			std::vector<MaterialPtr> results;
+			results.reserve(batch.size());
+			{
+				QMutexLocker lock(&mutex);
+				// Replies from before a clear are dropped
+				if (reply && generation == this->generation)
+					for (auto &material: *reply.msg->mutable_value())
+						insert(std::move(material), details);
+				for (const auto &[key, p]: batch) {
+					auto slot = reply ? findSlot(key) : nullptr;
+					results.push_back(slot ? slot->material : nullptr);
+				}
+			}
+			auto result = results.begin();
+			for (auto &[key, p]: batch) {
+				p.promise.addResult(std::move(*result++));
+				p.promise.finish();
+			}
+		});
+}
+
+void MaterialCache::insert(dfproto::BasicMaterialInfo &&material, Details details)
+{
+	auto &slot = findOrInsertSlot(make_key(material.type(), material.index()));
+	// A reply with fewer details must not downgrade the cached entry
+	if (slot.material && (slot.details & details) == details)
+		return;
+	auto ptr = std::make_shared<dfproto::BasicMaterialInfo>();
+	ptr->Swap(&material);
+	if (slot.material) {
+		// Keep the details only the cached entry has
+		Details missing = slot.details & ~details;
+		if (missing.testFlag(Detail::Flags)) {
+			*ptr->mutable_flags() = slot.material->flags();
+			*ptr->mutable_inorganic_flags() = slot.material->inorganic_flags();
+		}
+		if (missing.testFlag(Detail::Reaction)) {
+			*ptr->mutable_reaction_class() = slot.material->reaction_class();
+			*ptr->mutable_reaction_product() = slot.material->reaction_product();
+		}
+		details |= slot.details;
+	}
+	slot.details = details;
+	slot.material = std::move(ptr);
+}
+
+const MaterialCache::Slot *MaterialCache::findSlot(Key key) const
+{
+	auto mask = table.size() - 1;
+	for (auto i = slot_hash(key, table.size());; i = (i + 1) & mask) {
+		const auto &slot = table[i];
+		if (!slot.used)
+			return nullptr;
+		if (slot.key == key)
+			return &slot;
+	}
+}
+
+MaterialCache::Slot &MaterialCache::findOrInsertSlot(Key key)
+{
+	if (2 * (used_slots + 1) > table.size())
+		grow();
+	auto mask = table.size() - 1;
+	for (auto i = slot_hash(key, table.size());; i = (i + 1) & mask) {
+		auto &slot = table[i];
+		if (!slot.used) {
+			slot.used = true;
+			slot.key = key;
+			++used_slots;
+			return slot;
+		}
+		if (slot.key == key)
+			return slot;
+	}
+}
+
+void MaterialCache::grow()
+{
+	std::vector<Slot> old(table.size() * 2);
+	old.swap(table);
+	auto mask = table.size() - 1;
+	for (auto &slot: old) {
+		if (!slot.used)
+			continue;
+		auto i = slot_hash(slot.key, table.size());
+		while (table[i].used)
+			i = (i + 1) & mask;
+		table[i] = std::move(slot);
+	}
+}
@@ -0,0 +1,135 @@
+/*
+ * Copyright 2023 Clement Vuchener
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef DFHACK_CLIENT_QT_DFHACK_MATERIAL_CACHE_H
+#define DFHACK_CLIENT_QT_DFHACK_MATERIAL_CACHE_H
+
+#include <QMutex>
+#include <QObject>
+
+#include <unordered_map>
+#include <vector>
+
+#include <dfhack-client-qt/Basic.h>
+
+namespace DFHack
+{
+
+/**
+ * Lazily loaded cache of BasicMaterialInfo.
+ *
+ * Materials are fetched on first use. All misses from one event loop turn
+ * (of the cache thread) are fetched with a single ListMaterials call using
+ * an id list.
+ *
+ * Requesting more details (flags, reactions) than an entry was fetched with
+ * fetches it again and replaces the entry, keeping the details of the old
+ * entry. Replies with fewer details than the cached entry are ignored.
+ * Materials are immutable once cached: pointers to old entries stay valid.
+ *
+ * \ref get and \ref find are thread-safe.
+ */
+class DFHACK_CLIENT_QT_EXPORT MaterialCache: public QObject
+{
+	Q_OBJECT
+public:
+	/**
+	 * Optional parts of BasicMaterialInfo, see BasicMaterialInfoMask.
+	 */
+	enum class Detail
+	{
+		Flags = 0x01, ///< flags and inorganic_flags
+		Reaction = 0x02, ///< reaction_class and reaction_product
+	};
+	Q_DECLARE_FLAGS(Details, Detail)
+
+	using MaterialPtr = std::shared_ptr<const dfproto::BasicMaterialInfo>;
+
+	MaterialCache(Client &client, QObject *parent = nullptr);
+	~MaterialCache() override;
+
+	/**
+	 * Set which states are listed in materials (states and temperature
+	 * fields of \p mask, other fields are ignored). This clears the cache.
+	 */
+	void setStateMask(const dfproto::BasicMaterialInfoMask &mask);
+
+	/**
+	 * Get material (\p type, \p index) with at least \p details.
+	 *
+	 * \returns a ready future if the material is cached, or a future
+	 * finished when the batch containing it is received. The result is
+	 * nullptr if the material does not exist or the call failed.
+	 */
+	QFuture<MaterialPtr> get(int type, int index, Details details = {});
+	/**
+	 * Get material (\p type, \p index) only if it is already cached with
+	 * at least \p details.
+	 */
+	MaterialPtr find(int type, int index, Details details = {}) const;
+
+	/**
+	 * Number of cached materials.
+	 */
+	std::size_t size() const;
+	/**
+	 * Remove all materials (e.g. after loading another world).
+	 */
+	void clear();
+
+private:
+	using Key = std::uint64_t;
+	static Key make_key(int type, int index);
+	void flush();
+	void insert(dfproto::BasicMaterialInfo &&material, Details details);
+
+	// Open addressing table with linear probing
+	struct Slot
+	{
+		Key key;
+		bool used = false;
+		Details details;
+		MaterialPtr material;
+	};
+	const Slot *findSlot(Key key) const;
+	Slot &findOrInsertSlot(Key key);
+	void grow();
+
+	struct Pending
+	{
+		Details details;
+		QPromise<MaterialPtr> promise;
+		QFuture<MaterialPtr> future;
+	};
+
+	Client &client;
+	Basic basic;
+	mutable QMutex mutex;
+	dfproto::BasicMaterialInfoMask state_mask;
+	std::vector<Slot> table;
+	std::size_t used_slots = 0;
+	quint64 generation = 0; // incremented when the cache is cleared
+	std::unordered_map<Key, Pending> pending;
+	bool flush_queued = false;
+};
+
+Q_DECLARE_OPERATORS_FOR_FLAGS(MaterialCache::Details)
+
+} // namespace DFHack
+
+#endif
@@ -0,0 +1,203 @@
+/*
+ * Copyright 2023 Clement Vuchener
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef DFHACK_CLIENT_QT_DFHACK_MESSAGE_POOL_H
+#define DFHACK_CLIENT_QT_DFHACK_MESSAGE_POOL_H
+
+#include <QMutex>
+
+#include <algorithm>
+#include <memory>
+#include <new>
+#include <vector>
+
+namespace DFHack
+{
+
+/**
+ * Bounded pool of recycled reply messages.
+ *
+ * Messages obtained from \ref acquire are returned to the pool when the last
+ * shared pointer to them (usually the CallReply) is destroyed. Returned
+ * messages are cleared, protobuf keeps the capacity of their repeated fields
+ * and strings, so parsing the same kind of reply again does not allocate once
+ * the messages have grown to their steady-state size.
+ *
+ * The shared pointer control blocks are recycled too. At most \p capacity
+ * messages are kept, extra messages are freed when released.
+ *
+ * The pool is thread-safe and may be destroyed before the messages it gave.
+ */
+template <typename T>
+class MessagePool
+{
+public:
+	MessagePool(std::size_t capacity = 4)
+		: state(std::make_shared<State>(capacity))
+	{
+	}
+
+	/**
+	 * Get an empty message from the pool, or a new one if the pool is
+	 * empty.
+	 */
+	std::shared_ptr<T> acquire()
+	{
+		T *msg = nullptr;
+		{
+			QMutexLocker lock(&state->mutex);
+			if (!state->messages.empty()) {
+				msg = state->messages.back().release();
+				state->messages.pop_back();
+			}
+		}
+		if (!msg)
+			msg = new T;
+		return std::shared_ptr<T>(msg, Deleter{state}, Allocator<T>{state});
+	}
+
+	/**
+	 * Number of messages currently available in the pool.
+	 */
+	std::size_t available() const
+	{
+		QMutexLocker lock(&state->mutex);
+		return state->messages.size();
+	}
+
+private:
+	struct State
+	{
+		mutable QMutex mutex;
+		const std::size_t capacity;
+		std::vector<std::unique_ptr<T>> messages;
+		// Intrusive list of free control blocks, all of block_size bytes
+		struct Block { Block *next; };
+		Block *blocks = nullptr;
+		std::size_t block_count = 0;
+		std::size_t block_size = 0;
+
+		State(std::size_t capacity)
+			: capacity(capacity)
+		{
+			messages.reserve(capacity);
+		}
+
+		~State()
+		{
+			while (blocks) {
+				auto next = blocks->next;
+				::operator delete(blocks);
+				blocks = next;
+			}
+		}
+
+		void release(T *msg)
+		{
+			{
+				QMutexLocker lock(&mutex);
+				if (messages.size() < capacity) {
+					msg->Clear();
+					messages.emplace_back(msg);
+					return;
+				}
+			}
+			delete msg;
+		}
+
+		void *allocateBlock(std::size_t size)
+		{
+			std::size_t alloc_size = size;
+			{
+				QMutexLocker lock(&mutex);
+				if (block_size == 0)
+					block_size = std::max(size, sizeof(Block));
+				if (size <= block_size) {
+					if (blocks) {
+						auto block = blocks;
+						blocks = block->next;
+						--block_count;
+						return block;
+					}
+					alloc_size = block_size;
+				}
+			}
+			return ::operator new(alloc_size);
+		}
+
+		void deallocateBlock(void *p, std::size_t size)
+		{
+			{
+				QMutexLocker lock(&mutex);
+				if (size <= block_size && block_count < capacity) {
+					blocks = new (p) Block{blocks};
+					++block_count;
+					return;
+				}
+			}
+			::operator delete(p);
+		}
+	};
+
+	struct Deleter
+	{
+		std::shared_ptr<State> state;
+
+		void operator()(T *msg) const { state->release(msg); }
+	};
+
+	template <typename U>
+	struct Allocator
+	{
+		using value_type = U;
+		std::shared_ptr<State> state;
+
+		Allocator(std::shared_ptr<State> state) noexcept
+			: state(std::move(state))
+		{
+		}
+
+		template <typename V>
+		Allocator(const Allocator<V> &other) noexcept
+			: state(other.state)
+		{
+		}
+
+		U *allocate(std::size_t n)
+		{
+			return static_cast<U *>(state->allocateBlock(n * sizeof(U)));
+		}
+
+		void deallocate(U *p, std::size_t n) noexcept
+		{
+			state->deallocateBlock(p, n * sizeof(U));
+		}
+
+		template <typename V>
+		bool operator==(const Allocator<V> &other) const noexcept
+		{
+			return state == other.state;
+		}
+	};
+
+	std::shared_ptr<State> state;
+};
+
+} // namespace DFHack
+
+#endif
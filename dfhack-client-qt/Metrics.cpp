@@ -0,0 +1,206 @@
+/*
+ * Copyright 2023 Clement Vuchener
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <dfhack-client-qt/Metrics.h>
+
+#include <QSaveFile>
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <cstdio>
+#include <numeric>
+#include <tuple>
+
+using namespace DFHack;
+
+void LatencyHistogram::record(std::chrono::nanoseconds duration)
+{
+	auto ns = std::max<std::int64_t>(duration.count(), 0);
+	++buckets[bucketIndex(ns)];
+	++total_count;
+	total_sum += ns;
+	max_value = std::max(max_value, ns);
+}
+
+void LatencyHistogram::clear()
+{
+	*this = LatencyHistogram();
+}
+
+std::chrono::nanoseconds LatencyHistogram::mean() const
+{
+	if (total_count == 0)
+		return std::chrono::nanoseconds(0);
+	return std::chrono::nanoseconds(total_sum / static_cast<std::int64_t>(total_count));
+}
+
+std::chrono::nanoseconds LatencyHistogram::percentile(double p) const
+{
+	if (total_count == 0)
+		return std::chrono::nanoseconds(0);
+	auto rank = std::clamp<std::uint64_t>(std::ceil(p * total_count), 1, total_count);
+	std::uint64_t seen = 0;
+	for (std::size_t i = 0; i < BucketCount; ++i) {
+		seen += buckets[i];
+		if (seen >= rank)
+			return std::chrono::nanoseconds(std::min(bucketLowerBound(i + 1), max_value));
+	}
+	return max();
+}
+
+std::int64_t LatencyHistogram::bucketLowerBound(std::size_t i)
+{
+	if (i < SubBuckets)
+		return static_cast<std::int64_t>(i);
+	int magnitude = static_cast<int>(i / SubBuckets) + SubBucketBits - 1;
+	auto sub = static_cast<std::int64_t>(i % SubBuckets);
+	return (SubBuckets + sub) << (magnitude - SubBucketBits);
+}
+
+std::size_t LatencyHistogram::bucketIndex(std::int64_t ns)
+{
+	if (ns < SubBuckets)
+		return ns < 0 ? 0 : static_cast<std::size_t>(ns);
+	auto value = static_cast<std::uint64_t>(ns);
+	int magnitude = std::bit_width(value) - 1;
+	if (magnitude >= MaxBits)
+		return BucketCount - 1;
+	auto sub = (value >> (magnitude - SubBucketBits)) & (SubBuckets - 1);
+	return static_cast<std::size_t>(magnitude - SubBucketBits + 1) * SubBuckets + sub;
+}
+
+std::uint64_t MethodMetrics::calls() const
+{
+	return std::accumulate(results.begin(), results.end(), std::uint64_t(0));
+}
+
+static const char *result_label(int cr)
+{
+	switch (static_cast<CommandResult>(cr)) {
+	case CommandResult::Timeout: return "timeout";
+	case CommandResult::LinkFailure: return "link_failure";
+	case CommandResult::NeedsConsole: return "needs_console";
+	case CommandResult::NotImplemented: return "not_implemented";
+	case CommandResult::Ok: return "ok";
+	case CommandResult::Failure: return "failure";
+	case CommandResult::WrongUsage: return "wrong_usage";
+	case CommandResult::NotFound: return "not_found";
+	default: return "unknown";
+	}
+}
+
+static std::string method_labels(const ClientMetrics::MethodKey &key)
+{
+	std::string labels = "plugin=\"";
+	auto append_escaped = [&labels](const std::string &value) {
+		for (char c: value) {
+			switch (c) {
+			case '\\': labels += "\\\\"; break;
+			case '"': labels += "\\\""; break;
+			case '\n': labels += "\\n"; break;
+			default: labels += c;
+			}
+		}
+	};
+	append_escaped(key.first);
+	labels += "\",method=\"";
+	append_escaped(key.second);
+	labels += '"';
+	return labels;
+}
+
+static std::string seconds(std::int64_t ns)
+{
+	char buffer[32];
+	std::snprintf(buffer, sizeof(buffer), "%.9g", ns * 1e-9);
+	return buffer;
+}
+
+static void write_histogram(std::string &out, const char *name, const std::string &labels,
+		const LatencyHistogram &histogram)
+{
+	// Export every other power of two from about 1us to about 1min
+	static constexpr int FirstBits = 10, LastBits = 36;
+	std::size_t bucket = 0;
+	std::uint64_t cumulative = 0;
+	for (int bits = FirstBits; bits <= LastBits; bits += 2) {
+		auto bound = std::int64_t(1) << bits;
+		for (auto end = LatencyHistogram::bucketIndex(bound); bucket < end; ++bucket)
+			cumulative += histogram.bucket(bucket);
+		out += name;
+		out += "_bucket{" + labels + ",le=\"" + seconds(bound) + "\"} " + std::to_string(cumulative) + '\n';
+	}
+	out += name;
+	out += "_bucket{" + labels + ",le=\"+Inf\"} " + std::to_string(histogram.count()) + '\n';
+	out += name;
+	out += "_sum{" + labels + "} " + seconds(histogram.sum().count()) + '\n';
+	out += name;
+	out += "_count{" + labels + "} " + std::to_string(histogram.count()) + '\n';
+}
+
+void ClientMetrics::writePrometheus(QIODevice &device) const
+{
+	std::string out;
+	out += "# HELP dfhack_client_calls_total Finished calls by result.\n"
+		"# TYPE dfhack_client_calls_total counter\n";
+	for (const auto &[key, method]: methods) {
+		auto labels = method_labels(key);
+		for (int cr = MethodMetrics::MinResult; cr <= MethodMetrics::MaxResult; ++cr) {
+			if (auto count = method.count(static_cast<CommandResult>(cr)))
+				out += "dfhack_client_calls_total{" + labels + ",result=\"" + result_label(cr) + "\"} "
+					+ std::to_string(count) + '\n';
+		}
+	}
+	for (auto [name, help, field]: {
+			std::tuple{"dfhack_client_request_bytes_total", "Bytes sent in requests.", &MethodMetrics::request_bytes},
+			std::tuple{"dfhack_client_reply_bytes_total", "Bytes received in replies.", &MethodMetrics::reply_bytes},
+			std::tuple{"dfhack_client_notification_bytes_total", "Bytes received in text notifications.", &MethodMetrics::notification_bytes}}) {
+		out += std::string("# HELP ") + name + ' ' + help + '\n';
+		out += std::string("# TYPE ") + name + " counter\n";
+		for (const auto &[key, method]: methods)
+			out += std::string(name) + '{' + method_labels(key) + "} " + std::to_string(method.*field) + '\n';
+	}
+	for (auto [name, help, field]: {
+			std::tuple{"dfhack_client_queue_wait_seconds", "Time from queuing to sending.", &MethodMetrics::queue_wait},
+			std::tuple{"dfhack_client_wire_seconds", "Time from sending to the result.", &MethodMetrics::wire_time}}) {
+		out += std::string("# HELP ") + name + ' ' + help + '\n';
+		out += std::string("# TYPE ") + name + " histogram\n";
+		for (const auto &[key, method]: methods)
+			write_histogram(out, name, method_labels(key), method.*field);
+	}
+	out += "# HELP dfhack_client_pending_calls Calls queued or waiting for their reply.\n"
+		"# TYPE dfhack_client_pending_calls gauge\n"
+		"dfhack_client_pending_calls " + std::to_string(pending_calls) + '\n';
+	out += "# HELP dfhack_client_queued_calls Calls waiting to be sent.\n"
+		"# TYPE dfhack_client_queued_calls gauge\n";
+	static constexpr const char *priorities[] = {"interactive", "normal", "bulk"};
+	for (std::size_t i = 0; i < queued.size(); ++i)
+		out += std::string("dfhack_client_queued_calls{priority=\"") + priorities[i] + "\"} "
+			+ std::to_string(queued[i]) + '\n';
+	device.write(out.data(), out.size());
+}
+
+bool ClientMetrics::savePrometheus(const QString &filename) const
+{
+	QSaveFile file(filename);
+	if (!file.open(QIODevice::WriteOnly))
+		return false;
+	writePrometheus(file);
+	return file.commit();
+}
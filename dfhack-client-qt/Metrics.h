@@ -0,0 +1,152 @@
+/*
+ * Copyright 2023 Clement Vuchener
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef DFHACK_CLIENT_QT_DFHACK_METRICS_H
+#define DFHACK_CLIENT_QT_DFHACK_METRICS_H
+
+#include <QString>
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <utility>
+
+#include <dfhack-client-qt/globals.h>
+#include <dfhack-client-qt/CommandResult.h>
+
+class QIODevice;
+
+namespace DFHack
+{
+
+/**
+ * Histogram of durations with logarithmic buckets.
+ *
+ * Like HDR histograms, each power of two is split in 8 linear sub-buckets,
+ * so that values are recorded with a relative error below 12.5% using a
+ * fixed array. Durations are in nanoseconds, up to 2^40 ns (about 18
+ * minutes), longer durations are counted in the last bucket.
+ */
+class DFHACK_CLIENT_QT_EXPORT LatencyHistogram
+{
+public:
+	static constexpr int SubBucketBits = 3;
+	static constexpr int SubBuckets = 1 << SubBucketBits;
+	static constexpr int MaxBits = 40;
+	static constexpr std::size_t BucketCount = (MaxBits - SubBucketBits + 1) * SubBuckets;
+
+	void record(std::chrono::nanoseconds duration);
+	void clear();
+
+	std::uint64_t count() const { return total_count; }
+	std::chrono::nanoseconds sum() const { return std::chrono::nanoseconds(total_sum); }
+	std::chrono::nanoseconds max() const { return std::chrono::nanoseconds(max_value); }
+	std::chrono::nanoseconds mean() const;
+	/**
+	 * Upper bound of the bucket containing percentile \p p (in [0, 1]).
+	 */
+	std::chrono::nanoseconds percentile(double p) const;
+
+	std::uint64_t bucket(std::size_t i) const { return buckets[i]; }
+	/**
+	 * Smallest value counted in bucket \p i, the bucket upper bound
+	 * (excluded) is the lower bound of bucket i+1.
+	 */
+	static std::int64_t bucketLowerBound(std::size_t i);
+	static std::size_t bucketIndex(std::int64_t ns);
+
+private:
+	std::array<std::uint64_t, BucketCount> buckets = {};
+	std::uint64_t total_count = 0;
+	std::int64_t total_sum = 0;
+	std::int64_t max_value = 0;
+};
+
+/**
+ * Counters for calls to a single method.
+ */
+struct DFHACK_CLIENT_QT_EXPORT MethodMetrics
+{
+	static constexpr int MinResult = static_cast<int>(CommandResult::Timeout);
+	static constexpr int MaxResult = static_cast<int>(CommandResult::NotFound);
+	/**
+	 * Finished calls by result, use \ref count to index it.
+	 */
+	std::array<std::uint64_t, MaxResult - MinResult + 1> results = {};
+	/**
+	 * Bytes written and read, message headers included.
+	 */
+	std::uint64_t request_bytes = 0;
+	std::uint64_t reply_bytes = 0;
+	std::uint64_t notification_bytes = 0;
+	/**
+	 * Time from queuing to sending, for sent calls.
+	 */
+	LatencyHistogram queue_wait;
+	/**
+	 * Time from sending to the result, for sent calls.
+	 */
+	LatencyHistogram wire_time;
+
+	std::uint64_t count(CommandResult cr) const
+	{
+		return results[static_cast<int>(cr) - MinResult];
+	}
+	std::uint64_t calls() const;
+	std::uint64_t failures() const { return calls() - count(CommandResult::Ok); }
+};
+
+/**
+ * Snapshot of the metrics of a Client.
+ *
+ * \see Client::setMetricsEnabled
+ */
+struct DFHACK_CLIENT_QT_EXPORT ClientMetrics
+{
+	/**
+	 * Plugin and method names from the bind request. Plugin is empty for
+	 * core methods. Calls using a fixed id have the method name "id<N>",
+	 * except BindMethod and RunCommand.
+	 */
+	using MethodKey = std::pair<std::string, std::string>;
+	std::map<MethodKey, MethodMetrics> methods;
+	/**
+	 * Calls queued or waiting for their reply (Client::queueDepth).
+	 */
+	int pending_calls = 0;
+	/**
+	 * Calls waiting to be sent for each CallOptions::Priority.
+	 */
+	std::array<int, 3> queued = {};
+
+	/**
+	 * Write metrics in Prometheus text exposition format.
+	 */
+	void writePrometheus(QIODevice &device) const;
+	/**
+	 * Atomically replace \p filename with the metrics in Prometheus
+	 * text format (e.g. for the node exporter textfile collector).
+	 */
+	bool savePrometheus(const QString &filename) const;
+};
+
+} // namespace DFHack
+
+#endif
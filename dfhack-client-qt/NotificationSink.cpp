@@ -0,0 +1,115 @@
+/*
+ * Copyright 2023 Clement Vuchener
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <dfhack-client-qt/NotificationSink.h>
+
+#include <QIODevice>
+
+#include <algorithm>
+
+using namespace DFHack;
+
+CallbackSink::CallbackSink(Callback callback)
+	: callback(std::move(callback))
+{
+}
+
+CallbackSink::~CallbackSink()
+{
+}
+
+void CallbackSink::write(Color color, std::string_view text)
+{
+	callback(color, text);
+}
+
+DeviceSink::DeviceSink(QIODevice *device)
+	: device(device)
+{
+}
+
+DeviceSink::~DeviceSink()
+{
+}
+
+void DeviceSink::write(Color, std::string_view text)
+{
+	device->write(text.data(), text.size());
+}
+
+RingBufferSink::RingBufferSink(std::size_t capacity)
+	: buffer(std::max<std::size_t>(capacity, 1), '\0')
+{
+}
+
+RingBufferSink::~RingBufferSink()
+{
+}
+
+void RingBufferSink::write(Color, std::string_view text)
+{
+	QMutexLocker lock(&mutex);
+	auto capacity = buffer.size();
+	if (text.size() > capacity) {
+		dropped_bytes += text.size() - capacity;
+		text.remove_prefix(text.size() - capacity);
+	}
+	// Drop the oldest bytes to make room
+	auto overflow = (length + text.size()) > capacity ? length + text.size() - capacity : 0;
+	start = (start + overflow) % capacity;
+	length -= overflow;
+	dropped_bytes += overflow;
+	// Copy in at most two parts
+	auto end = (start + length) % capacity;
+	auto first = std::min(text.size(), capacity - end);
+	std::copy_n(text.data(), first, buffer.data() + end);
+	std::copy_n(text.data() + first, text.size() - first, buffer.data());
+	length += text.size();
+}
+
+std::string RingBufferSink::contents() const
+{
+	QMutexLocker lock(&mutex);
+	auto capacity = buffer.size();
+	std::string result;
+	result.reserve(length);
+	auto first = std::min(length, capacity - start);
+	result.append(buffer, start, first);
+	result.append(buffer, 0, length - first);
+	if (dropped_bytes > 0) {
+		// Skip UTF-8 continuation bytes of a truncated character
+		auto skip = std::find_if(result.begin(), result.end(), [](char c) {
+			return (static_cast<unsigned char>(c) & 0xc0) != 0x80;
+		});
+		result.erase(result.begin(), skip);
+	}
+	return result;
+}
+
+std::uint64_t RingBufferSink::dropped() const
+{
+	QMutexLocker lock(&mutex);
+	return dropped_bytes;
+}
+
+void RingBufferSink::clear()
+{
+	QMutexLocker lock(&mutex);
+	start = length = 0;
+	dropped_bytes = 0;
+}
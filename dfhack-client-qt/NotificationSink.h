@@ -0,0 +1,121 @@
+/*
+ * Copyright 2023 Clement Vuchener
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef DFHACK_CLIENT_QT_DFHACK_NOTIFICATION_SINK_H
+#define DFHACK_CLIENT_QT_DFHACK_NOTIFICATION_SINK_H
+
+#include <QMutex>
+
+#include <functional>
+#include <string>
+#include <string_view>
+
+#include <dfhack-client-qt/Client.h>
+
+class QIODevice;
+
+namespace DFHack
+{
+
+/**
+ * Receives the text notifications of a call as they arrive.
+ *
+ * \see CallOptions::notification_sink
+ */
+class DFHACK_CLIENT_QT_EXPORT NotificationSink
+{
+public:
+	virtual ~NotificationSink() = default;
+	/**
+	 * Called in the client thread for each text fragment. \p text is
+	 * UTF-8 and only valid during the call.
+	 */
+	virtual void write(Color color, std::string_view text) = 0;
+};
+
+/**
+ * Sink calling a function for each fragment.
+ */
+class DFHACK_CLIENT_QT_EXPORT CallbackSink: public NotificationSink
+{
+public:
+	using Callback = std::function<void(Color color, std::string_view text)>;
+
+	CallbackSink(Callback callback);
+	~CallbackSink() override;
+
+	void write(Color color, std::string_view text) override;
+
+private:
+	Callback callback;
+};
+
+/**
+ * Sink writing text to a device (e.g. a QFile), colors are ignored.
+ *
+ * The device is written from the client thread, it must not be used from
+ * another thread during the call.
+ */
+class DFHACK_CLIENT_QT_EXPORT DeviceSink: public NotificationSink
+{
+public:
+	DeviceSink(QIODevice *device);
+	~DeviceSink() override;
+
+	void write(Color color, std::string_view text) override;
+
+private:
+	QIODevice *device;
+};
+
+/**
+ * Sink keeping only the last \p capacity bytes of text, colors are
+ * ignored.
+ *
+ * This is thread-safe: it can be read while the call is running.
+ */
+class DFHACK_CLIENT_QT_EXPORT RingBufferSink: public NotificationSink
+{
+public:
+	RingBufferSink(std::size_t capacity);
+	~RingBufferSink() override;
+
+	void write(Color color, std::string_view text) override;
+
+	/**
+	 * Text currently in the buffer (UTF-8). If older text was dropped,
+	 * it starts at the first complete character.
+	 */
+	std::string contents() const;
+	/**
+	 * Number of bytes dropped because the buffer was full.
+	 */
+	std::uint64_t dropped() const;
+	void clear();
+
+private:
+	mutable QMutex mutex;
+	std::string buffer; // allocated to capacity
+	std::size_t start = 0; // index of the oldest byte
+	std::size_t length = 0;
+	std::uint64_t dropped_bytes = 0;
+};
+
+} // namespace DFHack
+
+#endif
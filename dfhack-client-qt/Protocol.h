@@ -0,0 +1,58 @@
+/*
+ * Copyright 2023 Clement Vuchener
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef DFHACK_CLIENT_QT_DFHACK_PROTOCOL_H
+#define DFHACK_CLIENT_QT_DFHACK_PROTOCOL_H
+
+#include <cstddef>
+#include <cstdint>
+
+namespace DFHack
+{
+
+/**
+ * Wire structures of the DFHack remote protocol.
+ *
+ * They are sent as raw memory, padding included, like DFHack does.
+ */
+struct HandshakePacket
+{
+	static constexpr std::size_t MagicSize = 8;
+	static constexpr char RequestMagic[MagicSize] = {'D','F','H','a','c','k','?','\n'};
+	static constexpr char ReplyMagic[MagicSize] = {'D','F','H','a','c','k','!','\n'};
+
+	char magic[MagicSize];
+	int version;
+};
+
+struct MessageHeader
+{
+	static constexpr int16_t ReplyResult = -1;
+	static constexpr int16_t ReplyFail = -2;
+	static constexpr int16_t ReplyText = -3;
+	static constexpr int16_t RequestQuit = -4;
+
+	static constexpr int32_t MaxMessageSize = 64*1024*1024;
+
+	int16_t id;
+	int32_t size;
+};
+
+} // namespace DFHack
+
+#endif
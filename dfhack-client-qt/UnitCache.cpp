@@ -0,0 +1,147 @@
+/*
+ * Copyright 2023 Clement Vuchener
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <dfhack-client-qt/UnitCache.h>
+
+#include <algorithm>
+
+using namespace DFHack;
+
+static bool same_skill(const dfproto::SkillInfo &a, const dfproto::SkillInfo &b)
+{
+	return a.id() == b.id() && a.level() == b.level() && a.experience() == b.experience();
+}
+
+static bool same_trait(const dfproto::UnitMiscTrait &a, const dfproto::UnitMiscTrait &b)
+{
+	return a.id() == b.id() && a.value() == b.value();
+}
+
+static bool same_name(const dfproto::NameInfo &a, const dfproto::NameInfo &b)
+{
+	return a.first_name() == b.first_name()
+		&& a.nickname() == b.nickname()
+		&& a.language_id() == b.language_id()
+		&& a.last_name() == b.last_name()
+		&& a.english_name() == b.english_name();
+}
+
+static bool same_curse(const dfproto::UnitCurseInfo &a, const dfproto::UnitCurseInfo &b)
+{
+	return a.add_tags1() == b.add_tags1()
+		&& a.rem_tags1() == b.rem_tags1()
+		&& a.add_tags2() == b.add_tags2()
+		&& a.rem_tags2() == b.rem_tags2()
+		&& a.has_name() == b.has_name()
+		&& a.name().normal() == b.name().normal()
+		&& a.name().plural() == b.name().plural()
+		&& a.name().adjective() == b.name().adjective();
+}
+
+UnitCache::UnitCache(Client &client, QObject *parent)
+	: QObject(parent)
+	, client(client)
+	, pool(2) // the current reply and the one being received
+{
+}
+
+UnitCache::~UnitCache()
+{
+}
+
+void UnitCache::setRequest(const dfproto::ListUnitsIn &request)
+{
+	list_request = request;
+}
+
+QFuture<CommandResult> UnitCache::refresh()
+{
+	CallOptions options;
+	options.priority = CallOptions::Priority::Bulk;
+	return basic.listUnits(client, pool, list_request, options).first.then(this,
+		[this](CallReply<dfproto::ListUnitsOut> reply) {
+			if (reply)
+				update(std::move(reply.msg));
+			return reply.cr;
+		});
+}
+
+const dfproto::BasicUnitInfo *UnitCache::unit(int unit_id) const
+{
+	auto it = index.find(unit_id);
+	return it == index.end() ? nullptr : it->second;
+}
+
+UnitCache::Fields UnitCache::compare(const dfproto::BasicUnitInfo &a, const dfproto::BasicUnitInfo &b)
+{
+	Fields fields;
+	if (a.pos_x() != b.pos_x() || a.pos_y() != b.pos_y() || a.pos_z() != b.pos_z())
+		fields |= Field::Position;
+	if (a.flags1() != b.flags1() || a.flags2() != b.flags2() || a.flags3() != b.flags3())
+		fields |= Field::Flags;
+	if (!std::ranges::equal(a.labors(), b.labors()))
+		fields |= Field::Labors;
+	if (!std::ranges::equal(a.skills(), b.skills(), same_skill))
+		fields |= Field::Skills;
+	if (a.squad_id() != b.squad_id() || a.squad_position() != b.squad_position())
+		fields |= Field::Squad;
+	if (a.profession() != b.profession() || a.custom_profession() != b.custom_profession())
+		fields |= Field::Profession;
+	if (a.has_name() != b.has_name() || !same_name(a.name(), b.name()))
+		fields |= Field::Name;
+	if (a.race() != b.race() || a.caste() != b.caste() || a.gender() != b.gender()
+			|| a.civ_id() != b.civ_id() || a.histfig_id() != b.histfig_id()
+			|| a.death_id() != b.death_id() || a.death_flags() != b.death_flags()
+			|| !std::ranges::equal(a.misc_traits(), b.misc_traits(), same_trait)
+			|| a.has_curse() != b.has_curse() || !same_curse(a.curse(), b.curse())
+			|| !std::ranges::equal(a.burrows(), b.burrows()))
+		fields |= Field::Other;
+	return fields;
+}
+
+void UnitCache::update(std::shared_ptr<dfproto::ListUnitsOut> &&units)
+{
+	QList<int> added, removed;
+	QList<Change> changed;
+	next_index.clear();
+	next_index.reserve(units->value_size());
+	for (const auto &unit: units->value()) {
+		auto id = unit.unit_id();
+		next_index.emplace(id, &unit);
+		auto it = index.find(id);
+		if (it == index.end())
+			added.append(id);
+		else if (auto fields = compare(*it->second, unit))
+			changed.append({id, fields});
+	}
+	for (const auto &[id, unit]: index)
+		if (!next_index.contains(id))
+			removed.append(id);
+	// The previous reply goes back to the pool once it is not used anymore
+	index.swap(next_index);
+	next_index.clear();
+	current = std::move(units);
+
+	if (!removed.isEmpty())
+		emit unitsRemoved(removed);
+	if (!added.isEmpty())
+		emit unitsAdded(added);
+	if (!changed.isEmpty())
+		emit unitsChanged(changed);
+	emit refreshed();
+}
@@ -0,0 +1,140 @@
+/*
+ * Copyright 2023 Clement Vuchener
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef DFHACK_CLIENT_QT_DFHACK_UNIT_CACHE_H
+#define DFHACK_CLIENT_QT_DFHACK_UNIT_CACHE_H
+
+#include <QObject>
+
+#include <unordered_map>
+
+#include <dfhack-client-qt/Basic.h>
+#include <dfhack-client-qt/MessagePool.h>
+
+namespace DFHack
+{
+
+/**
+ * Latest state of units from Basic::listUnits, with change notifications.
+ *
+ * Each \ref refresh lists units with the configured request and compares
+ * them to the previous list. Signals are emitted with only the units that
+ * were added, changed or removed.
+ *
+ * The cache must be used from the thread it lives in, except \ref refresh
+ * that may be called from any thread (but not concurrently with
+ * \ref setRequest). Signals are emitted and the content updated in the
+ * cache thread.
+ */
+class DFHACK_CLIENT_QT_EXPORT UnitCache: public QObject
+{
+	Q_OBJECT
+public:
+	/**
+	 * Groups of BasicUnitInfo fields compared between refreshes.
+	 */
+	enum class Field
+	{
+		Position = 0x01, ///< pos_x, pos_y, pos_z
+		Flags = 0x02, ///< flags1, flags2, flags3
+		Labors = 0x04,
+		Skills = 0x08,
+		Squad = 0x10, ///< squad_id, squad_position
+		Profession = 0x20, ///< profession, custom_profession
+		Name = 0x40,
+		/**
+		 * race, caste, gender, civ_id, histfig_id, death_id,
+		 * death_flags, misc_traits, curse and burrows
+		 */
+		Other = 0x80,
+	};
+	Q_DECLARE_FLAGS(Fields, Field)
+
+	struct Change
+	{
+		int unit_id;
+		Fields fields;
+	};
+
+	UnitCache(Client &client, QObject *parent = nullptr);
+	~UnitCache() override;
+
+	/**
+	 * Set the request used by \ref refresh (mask and filters). Units that
+	 * no longer match are removed on the next refresh.
+	 */
+	void setRequest(const dfproto::ListUnitsIn &request);
+	const dfproto::ListUnitsIn &request() const { return list_request; }
+
+	/**
+	 * List units and update the cache.
+	 *
+	 * The call has the CallOptions::Priority::Bulk priority.
+	 *
+	 * \returns a future result of the ListUnits call, finished after the
+	 * cache was updated and signals emitted.
+	 */
+	QFuture<CommandResult> refresh();
+
+	/**
+	 * Latest info for unit \p unit_id, nullptr if the unit is not in the
+	 * cache. The pointer is valid until the next update.
+	 */
+	const dfproto::BasicUnitInfo *unit(int unit_id) const;
+	/**
+	 * Number of units in the cache.
+	 */
+	std::size_t size() const { return index.size(); }
+	/**
+	 * Latest ListUnits reply. Keeping it does not prevent updates.
+	 */
+	std::shared_ptr<const dfproto::ListUnitsOut> snapshot() const { return current; }
+
+	/**
+	 * Fields that differ between \p a and \p b.
+	 */
+	static Fields compare(const dfproto::BasicUnitInfo &a, const dfproto::BasicUnitInfo &b);
+
+signals:
+	void unitsAdded(const QList<int> &unit_ids);
+	void unitsChanged(const QList<DFHack::UnitCache::Change> &changes);
+	void unitsRemoved(const QList<int> &unit_ids);
+	/**
+	 * Emitted after each successful refresh, after the other signals.
+	 */
+	void refreshed();
+
+private:
+	void update(std::shared_ptr<dfproto::ListUnitsOut> &&units);
+
+	Client &client;
+	Basic basic;
+	dfproto::ListUnitsIn list_request;
+	MessagePool<dfproto::ListUnitsOut> pool;
+	std::shared_ptr<const dfproto::ListUnitsOut> current;
+	std::unordered_map<int, const dfproto::BasicUnitInfo *> index;
+	std::unordered_map<int, const dfproto::BasicUnitInfo *> next_index;
+};
+
+Q_DECLARE_OPERATORS_FOR_FLAGS(UnitCache::Fields)
+
+} // namespace DFHack
+
+Q_DECLARE_METATYPE(DFHack::UnitCache::Change);
+
+#endif
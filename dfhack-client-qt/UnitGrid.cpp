@@ -0,0 +1,238 @@
+/*
+ * Copyright 2023 Clement Vuchener
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <dfhack-client-qt/UnitGrid.h>
+#include <dfhack-client-qt/UnitTable.h>
+
+#include <algorithm>
+
+using namespace DFHack;
+
+static int floor_div(int a, int b)
+{
+	return a / b - (a % b != 0 && (a < 0) != (b < 0));
+}
+
+static constexpr int CellKeyBits = 21;
+static constexpr std::uint64_t CellKeyMask = (std::uint64_t(1) << CellKeyBits) - 1;
+
+static std::uint64_t make_cell_key(int cx, int cy, int z)
+{
+	return ((std::uint64_t(cx) & CellKeyMask) << (2*CellKeyBits))
+		| ((std::uint64_t(cy) & CellKeyMask) << CellKeyBits)
+		| (std::uint64_t(z) & CellKeyMask);
+}
+
+UnitGrid::UnitGrid(int cell_size):
+	cell_size(std::max(cell_size, 1))
+{
+}
+
+UnitGrid::~UnitGrid()
+{
+}
+
+void UnitGrid::update(const dfproto::ListUnitsOut &list, bool complete)
+{
+	++generation;
+	for (const auto &unit: list.value())
+		insert(unit.unit_id(), {unit.pos_x(), unit.pos_y(), unit.pos_z()});
+	if (complete)
+		removeStale();
+}
+
+void UnitGrid::update(const UnitTable &table, bool complete)
+{
+	++generation;
+	for (std::size_t row = 0; row < table.size(); ++row)
+		insert(table.unit_id[row], {table.pos_x[row], table.pos_y[row], table.pos_z[row]});
+	if (complete)
+		removeStale();
+}
+
+void UnitGrid::insert(int unit_id, const Position &pos)
+{
+	auto key = cellKey(pos);
+	auto [it, inserted] = units.try_emplace(unit_id);
+	auto &entry = it->second;
+	entry.generation = generation;
+	if (!inserted) {
+		if (entry.pos == pos)
+			return;
+		if (entry.cell == key) { // moved inside the same cell
+			entry.pos = pos;
+			cells[key][entry.slot].pos = pos;
+			return;
+		}
+		removeFromCell(entry.cell, entry.slot);
+	}
+	entry.pos = pos;
+	entry.cell = key;
+	insertInCell(unit_id, pos, key);
+}
+
+bool UnitGrid::remove(int unit_id)
+{
+	auto it = units.find(unit_id);
+	if (it == units.end())
+		return false;
+	removeFromCell(it->second.cell, it->second.slot);
+	units.erase(it);
+	return true;
+}
+
+void UnitGrid::clear()
+{
+	units.clear();
+	cells.clear();
+}
+
+const UnitGrid::Position *UnitGrid::position(int unit_id) const
+{
+	auto it = units.find(unit_id);
+	if (it == units.end())
+		return nullptr;
+	return &it->second.pos;
+}
+
+void UnitGrid::box(const Position &min, const Position &max, std::vector<int> &out) const
+{
+	forEachInBox(min, max, [&out](const Item &item) {
+		out.push_back(item.unit_id);
+	});
+}
+
+void UnitGrid::withinRadius(const Position &center, int radius, std::vector<int> &out) const
+{
+	if (radius < 0)
+		return;
+	auto r2 = std::int64_t(radius) * radius;
+	forEachInBox({center.x - radius, center.y - radius, center.z - radius},
+			{center.x + radius, center.y + radius, center.z + radius},
+			[&](const Item &item) {
+				if (squaredDistance(item.pos, center) <= r2)
+					out.push_back(item.unit_id);
+			});
+}
+
+std::vector<int> UnitGrid::nearest(const Position &center, std::size_t k) const
+{
+	k = std::min(k, units.size());
+	std::vector<std::pair<std::int64_t, int>> found;
+	if (k == 0)
+		return {};
+	// Grow the search radius until it contains k units, units outside of
+	// the radius are farther than any unit inside.
+	for (std::int64_t radius = cell_size;; radius *= 2) {
+		found.clear();
+		auto r2 = radius * radius;
+		int r = int(std::min<std::int64_t>(radius, 1 << 20));
+		forEachInBox({center.x - r, center.y - r, center.z - r},
+				{center.x + r, center.y + r, center.z + r},
+				[&](const Item &item) {
+					auto d2 = squaredDistance(item.pos, center);
+					if (d2 <= r2)
+						found.emplace_back(d2, item.unit_id);
+				});
+		if (found.size() >= k || r == 1 << 20)
+			break;
+	}
+	k = std::min(k, found.size());
+	std::partial_sort(found.begin(), found.begin() + k, found.end());
+	std::vector<int> result(k);
+	for (std::size_t i = 0; i < k; ++i)
+		result[i] = found[i].second;
+	return result;
+}
+
+std::int64_t UnitGrid::squaredDistance(const Position &a, const Position &b)
+{
+	std::int64_t dx = a.x - b.x, dy = a.y - b.y, dz = a.z - b.z;
+	return dx*dx + dy*dy + dz*dz;
+}
+
+void UnitGrid::removeStale()
+{
+	for (auto it = units.begin(); it != units.end();) {
+		if (it->second.generation != generation) {
+			removeFromCell(it->second.cell, it->second.slot);
+			it = units.erase(it);
+		}
+		else
+			++it;
+	}
+}
+
+UnitGrid::CellKey UnitGrid::cellKey(const Position &pos) const
+{
+	return make_cell_key(floor_div(pos.x, cell_size), floor_div(pos.y, cell_size), pos.z);
+}
+
+void UnitGrid::insertInCell(int unit_id, const Position &pos, CellKey key)
+{
+	auto &cell = cells[key];
+	units.find(unit_id)->second.slot = cell.size();
+	cell.push_back({unit_id, pos});
+}
+
+void UnitGrid::removeFromCell(CellKey key, std::uint32_t slot)
+{
+	auto it = cells.find(key);
+	auto &cell = it->second;
+	if (slot + 1 != cell.size()) {
+		cell[slot] = cell.back();
+		units.find(cell[slot].unit_id)->second.slot = slot;
+	}
+	cell.pop_back();
+	if (cell.empty())
+		cells.erase(it);
+}
+
+template <typename F>
+void UnitGrid::forEachInBox(const Position &min, const Position &max, F &&f) const
+{
+	auto inside = [&min, &max](const Position &pos) {
+		return pos.x >= min.x && pos.x <= max.x
+			&& pos.y >= min.y && pos.y <= max.y
+			&& pos.z >= min.z && pos.z <= max.z;
+	};
+	if (min.x > max.x || min.y > max.y || min.z > max.z)
+		return;
+	int cx0 = floor_div(min.x, cell_size), cx1 = floor_div(max.x, cell_size);
+	int cy0 = floor_div(min.y, cell_size), cy1 = floor_div(max.y, cell_size);
+	auto cell_count = (std::int64_t(cx1) - cx0 + 1) * (std::int64_t(cy1) - cy0 + 1)
+		* (std::int64_t(max.z) - min.z + 1);
+	if (cell_count > std::int64_t(cells.size())) {
+		// Large box: scanning the non-empty cells is cheaper
+		for (const auto &[key, cell]: cells)
+			for (const auto &item: cell)
+				if (inside(item.pos))
+					f(item);
+		return;
+	}
+	for (int z = min.z; z <= max.z; ++z)
+		for (int cy = cy0; cy <= cy1; ++cy)
+			for (int cx = cx0; cx <= cx1; ++cx) {
+				auto it = cells.find(make_cell_key(cx, cy, z));
+				if (it == cells.end())
+					continue;
+				for (const auto &item: it->second)
+					if (inside(item.pos))
+						f(item);
+			}
+}
@@ -0,0 +1,135 @@
+/*
+ * Copyright 2023 Clement Vuchener
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef DFHACK_CLIENT_QT_DFHACK_UNIT_GRID_H
+#define DFHACK_CLIENT_QT_DFHACK_UNIT_GRID_H
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+#include <dfhack-client-qt/globals.h>
+#include <dfhack-client-qt/BasicApi.pb.h>
+
+namespace DFHack
+{
+
+class UnitTable;
+
+/**
+ * Spatial index of unit positions.
+ *
+ * Units are bucketed in a uniform grid of square cells, one layer per
+ * z-level. Updating from a new ListUnits reply only moves the units whose
+ * position changed.
+ *
+ * Distances are euclidean, in tiles, a z-level counting as one tile.
+ */
+class DFHACK_CLIENT_QT_EXPORT UnitGrid
+{
+public:
+	struct Position
+	{
+		int x, y, z;
+
+		bool operator==(const Position &) const = default;
+	};
+
+	/**
+	 * \p cell_size is the width of grid cells in tiles.
+	 */
+	UnitGrid(int cell_size = 16);
+	~UnitGrid();
+
+	/**
+	 * Update positions from \p units.
+	 *
+	 * If \p complete is true, \p units is the whole list and units that are
+	 * missing from it are removed. Use false for replies from a request
+	 * with an id list.
+	 */
+	void update(const dfproto::ListUnitsOut &units, bool complete = true);
+	/**
+	 * \copydoc update(const dfproto::ListUnitsOut &, bool)
+	 */
+	void update(const UnitTable &units, bool complete = true);
+
+	/**
+	 * Insert unit \p unit_id at \p pos, or move it if already present.
+	 */
+	void insert(int unit_id, const Position &pos);
+	/**
+	 * \returns false if the unit was not present.
+	 */
+	bool remove(int unit_id);
+	void clear();
+
+	std::size_t size() const { return units.size(); }
+	/**
+	 * Position of unit \p unit_id, nullptr if it is not in the index.
+	 */
+	const Position *position(int unit_id) const;
+
+	/**
+	 * Append to \p out the units inside the box from \p min to \p max
+	 * (inclusive).
+	 */
+	void box(const Position &min, const Position &max, std::vector<int> &out) const;
+	/**
+	 * Append to \p out the units at distance \p radius or less from
+	 * \p center.
+	 */
+	void withinRadius(const Position &center, int radius, std::vector<int> &out) const;
+	/**
+	 * Get the \p k units nearest to \p center, closest first.
+	 */
+	std::vector<int> nearest(const Position &center, std::size_t k) const;
+
+	static std::int64_t squaredDistance(const Position &a, const Position &b);
+
+private:
+	using CellKey = std::uint64_t;
+	CellKey cellKey(const Position &pos) const;
+	void insertInCell(int unit_id, const Position &pos, CellKey key);
+	void removeFromCell(CellKey key, std::uint32_t slot);
+	void removeStale();
+	template <typename F>
+	void forEachInBox(const Position &min, const Position &max, F &&f) const;
+
+	struct Entry
+	{
+		Position pos;
+		CellKey cell;
+		std::uint32_t slot; // index in the cell vector
+		std::uint64_t generation; // last update that listed this unit
+	};
+	struct Item // positions are duplicated in cells for faster queries
+	{
+		int unit_id;
+		Position pos;
+	};
+
+	int cell_size;
+	std::uint64_t generation = 0;
+	std::unordered_map<int, Entry> units;
+	std::unordered_map<CellKey, std::vector<Item>> cells;
+};
+
+} // namespace DFHack
+
+#endif
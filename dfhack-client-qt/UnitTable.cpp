@@ -0,0 +1,314 @@
+/*
+ * Copyright 2023 Clement Vuchener
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <dfhack-client-qt/UnitTable.h>
+
+#include <google/protobuf/io/coded_stream.h>
+#include <google/protobuf/wire_format_lite.h>
+
+#include <algorithm>
+#include <bit>
+
+using namespace DFHack;
+using google::protobuf::io::CodedInputStream;
+using google::protobuf::internal::WireFormatLite;
+
+// Field numbers from Basic.proto
+namespace field {
+static constexpr int ListUnitsOutValue = 1;
+enum BasicUnitInfo {
+	UnitId = 1,
+	Flags1 = 3,
+	Flags2 = 4,
+	Flags3 = 5,
+	Race = 6,
+	Caste = 7,
+	Gender = 8,
+	CivId = 9,
+	HistfigId = 10,
+	Labors = 11,
+	Skills = 12,
+	PosX = 13,
+	PosY = 14,
+	PosZ = 15,
+	SquadId = 19,
+	SquadPosition = 20,
+	Profession = 22,
+};
+enum SkillInfo {
+	SkillId = 1,
+	SkillLevel = 2,
+	SkillExperience = 3,
+};
+}
+
+// Bits for the required fields seen while decoding a message
+namespace required {
+enum BasicUnitInfo: unsigned {
+	UnitId = 1u << 0,
+	Flags1 = 1u << 1,
+	Flags2 = 1u << 2,
+	Flags3 = 1u << 3,
+	Race = 1u << 4,
+	Caste = 1u << 5,
+	PosX = 1u << 6,
+	PosY = 1u << 7,
+	PosZ = 1u << 8,
+	AllUnit = (1u << 9) - 1,
+};
+enum SkillInfo: unsigned {
+	SkillId = 1u << 0,
+	SkillLevel = 1u << 1,
+	SkillExperience = 1u << 2,
+	AllSkill = (1u << 3) - 1,
+};
+}
+
+// ConsumedEntireMessage also succeeds when the input ends before the
+// limit, truncated messages are detected by checking the limit was reached.
+static bool pop_limit(CodedInputStream &input, CodedInputStream::Limit limit)
+{
+	if (input.BytesUntilLimit() != 0)
+		return false;
+	input.PopLimit(limit);
+	return true;
+}
+
+// int32 fields are encoded as varints sign-extended to 64 bits,
+// ReadVarint32 keeps the low 32 bits.
+static bool read_int32(CodedInputStream &input, std::int32_t &value)
+{
+	std::uint32_t v;
+	if (!input.ReadVarint32(&v))
+		return false;
+	value = static_cast<std::int32_t>(v);
+	return true;
+}
+
+UnitTable::UnitTable()
+{
+	clear();
+}
+
+UnitTable::~UnitTable()
+{
+}
+
+void UnitTable::clear()
+{
+	for (auto column: {&unit_id, &pos_x, &pos_y, &pos_z, &race, &caste,
+			&gender, &civ_id, &histfig_id, &squad_id,
+			&squad_position, &profession, &labors,
+			&skill_id, &skill_level, &skill_experience})
+		column->clear();
+	for (auto &column: flags)
+		column.clear();
+	labor_offsets.assign(1, 0);
+	skill_offsets.assign(1, 0);
+}
+
+bool UnitTable::parseFromString(const std::string &data)
+{
+	CodedInputStream input(reinterpret_cast<const std::uint8_t *>(data.data()), data.size());
+	return decode(input);
+}
+
+bool UnitTable::decode(CodedInputStream &input)
+{
+	clear();
+	if (!decodeUnits(input)) {
+		clear();
+		return false;
+	}
+	return true;
+}
+
+bool UnitTable::decodeUnits(CodedInputStream &input)
+{
+	while (auto tag = input.ReadTag()) {
+		if (WireFormatLite::GetTagFieldNumber(tag) == field::ListUnitsOutValue
+				&& WireFormatLite::GetTagWireType(tag) == WireFormatLite::WIRETYPE_LENGTH_DELIMITED) {
+			std::uint32_t length;
+			if (!input.ReadVarint32(&length))
+				return false;
+			auto limit = input.PushLimit(length);
+			if (!decodeUnit(input) || !input.ConsumedEntireMessage()
+					|| !pop_limit(input, limit))
+				return false;
+		}
+		else if (!WireFormatLite::SkipField(&input, tag))
+			return false;
+	}
+	return input.ConsumedEntireMessage();
+}
+
+bool UnitTable::decodeUnit(CodedInputStream &input)
+{
+	auto row = unit_id.size();
+	for (auto column: {&unit_id, &pos_x, &pos_y, &pos_z, &race, &caste})
+		column->push_back(0);
+	for (auto column: {&gender, &civ_id, &histfig_id, &squad_id, &squad_position, &profession})
+		column->push_back(-1);
+	for (auto &column: flags)
+		column.push_back(0);
+
+	unsigned seen = 0;
+	while (auto tag = input.ReadTag()) {
+		auto number = WireFormatLite::GetTagFieldNumber(tag);
+		auto type = WireFormatLite::GetTagWireType(tag);
+		std::vector<std::int32_t> *int32_column = nullptr;
+		unsigned required_bit = 0;
+		switch (number) {
+		case field::UnitId: int32_column = &unit_id; required_bit = required::UnitId; break;
+		case field::PosX: int32_column = &pos_x; required_bit = required::PosX; break;
+		case field::PosY: int32_column = &pos_y; required_bit = required::PosY; break;
+		case field::PosZ: int32_column = &pos_z; required_bit = required::PosZ; break;
+		case field::Race: int32_column = &race; required_bit = required::Race; break;
+		case field::Caste: int32_column = &caste; required_bit = required::Caste; break;
+		case field::Gender: int32_column = &gender; break;
+		case field::CivId: int32_column = &civ_id; break;
+		case field::HistfigId: int32_column = &histfig_id; break;
+		case field::SquadId: int32_column = &squad_id; break;
+		case field::SquadPosition: int32_column = &squad_position; break;
+		case field::Profession: int32_column = &profession; break;
+		case field::Flags1:
+		case field::Flags2:
+		case field::Flags3:
+			if (type == WireFormatLite::WIRETYPE_FIXED32) {
+				if (!input.ReadLittleEndian32(&flags[number - field::Flags1][row]))
+					return false;
+				seen |= required::Flags1 << (number - field::Flags1);
+				continue;
+			}
+			break;
+		case field::Labors:
+			if (type == WireFormatLite::WIRETYPE_VARINT) {
+				if (!read_int32(input, labors.emplace_back()))
+					return false;
+				continue;
+			}
+			if (type == WireFormatLite::WIRETYPE_LENGTH_DELIMITED) { // packed
+				std::uint32_t length;
+				if (!input.ReadVarint32(&length))
+					return false;
+				auto limit = input.PushLimit(length);
+				while (input.BytesUntilLimit() > 0)
+					if (!read_int32(input, labors.emplace_back()))
+						return false;
+				if (!pop_limit(input, limit))
+					return false;
+				continue;
+			}
+			break;
+		case field::Skills:
+			if (type == WireFormatLite::WIRETYPE_LENGTH_DELIMITED) {
+				std::uint32_t length;
+				if (!input.ReadVarint32(&length))
+					return false;
+				auto limit = input.PushLimit(length);
+				if (!decodeSkill(input) || !input.ConsumedEntireMessage()
+						|| !pop_limit(input, limit))
+					return false;
+				continue;
+			}
+			break;
+		default:
+			break;
+		}
+		if (int32_column && type == WireFormatLite::WIRETYPE_VARINT) {
+			if (!read_int32(input, (*int32_column)[row]))
+				return false;
+			seen |= required_bit;
+		}
+		else if (!WireFormatLite::SkipField(&input, tag))
+			return false;
+	}
+	if (seen != required::AllUnit)
+		return false;
+	labor_offsets.push_back(labors.size());
+	skill_offsets.push_back(skill_id.size());
+	return true;
+}
+
+bool UnitTable::decodeSkill(CodedInputStream &input)
+{
+	auto &id = skill_id.emplace_back(0);
+	auto &level = skill_level.emplace_back(0);
+	auto &experience = skill_experience.emplace_back(0);
+	unsigned seen = 0;
+	while (auto tag = input.ReadTag()) {
+		std::int32_t *value = nullptr;
+		unsigned required_bit = 0;
+		switch (WireFormatLite::GetTagFieldNumber(tag)) {
+		case field::SkillId: value = &id; required_bit = required::SkillId; break;
+		case field::SkillLevel: value = &level; required_bit = required::SkillLevel; break;
+		case field::SkillExperience: value = &experience; required_bit = required::SkillExperience; break;
+		}
+		if (value && WireFormatLite::GetTagWireType(tag) == WireFormatLite::WIRETYPE_VARINT) {
+			if (!read_int32(input, *value))
+				return false;
+			seen |= required_bit;
+		}
+		else if (!WireFormatLite::SkipField(&input, tag))
+			return false;
+	}
+	return seen == required::AllSkill;
+}
+
+void UnitTable::match(const Filter &filter, std::vector<std::uint64_t> &bitmap) const
+{
+	auto n = size();
+	bitmap.assign((n + 63) / 64, 0);
+	// (flags & (set | clear)) == set checks both conditions at once
+	std::array<std::uint32_t, 3> mask, expected;
+	for (int k = 0; k < 3; ++k) {
+		mask[k] = filter.flags_set[k] | filter.flags_clear[k];
+		expected[k] = filter.flags_set[k];
+	}
+	const auto *f1 = flags[0].data(), *f2 = flags[1].data(), *f3 = flags[2].data();
+	const auto *races = race.data(), *civs = civ_id.data();
+	bool any_race = !filter.race, any_civ = !filter.civ_id;
+	auto race_value = filter.race.value_or(0), civ_value = filter.civ_id.value_or(0);
+	// Branchless inner loop over 64 rows, suitable for auto-vectorization
+	for (std::size_t base = 0; base < n; base += 64) {
+		auto count = std::min<std::size_t>(64, n - base);
+		std::uint64_t word = 0;
+		for (std::size_t j = 0; j < count; ++j) {
+			auto i = base + j;
+			bool ok = ((f1[i] & mask[0]) == expected[0])
+				& ((f2[i] & mask[1]) == expected[1])
+				& ((f3[i] & mask[2]) == expected[2])
+				& (any_race | (races[i] == race_value))
+				& (any_civ | (civs[i] == civ_value));
+			word |= std::uint64_t(ok) << j;
+		}
+		bitmap[base / 64] = word;
+	}
+}
+
+std::vector<std::uint32_t> UnitTable::select(const Filter &filter) const
+{
+	std::vector<std::uint64_t> bitmap;
+	match(filter, bitmap);
+	std::vector<std::uint32_t> rows;
+	for (std::size_t w = 0; w < bitmap.size(); ++w) {
+		for (auto word = bitmap[w]; word != 0; word &= word - 1)
+			rows.push_back(static_cast<std::uint32_t>(w * 64 + std::countr_zero(word)));
+	}
+	return rows;
+}
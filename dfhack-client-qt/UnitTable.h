@@ -0,0 +1,134 @@
+/*
+ * Copyright 2023 Clement Vuchener
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef DFHACK_CLIENT_QT_DFHACK_UNIT_TABLE_H
+#define DFHACK_CLIENT_QT_DFHACK_UNIT_TABLE_H
+
+#include <dfhack-client-qt/Client.h>
+
+#include <array>
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <string>
+#include <vector>
+
+namespace DFHack
+{
+
+/**
+ * ListUnitsOut decoded as columns (struct of arrays).
+ *
+ * The reply wire format is decoded in a single pass into contiguous arrays,
+ * one per field, indexed by row. Labors and skills are stored in shared
+ * arrays with per-row offsets. Names, traits, curses and burrows are not
+ * decoded.
+ *
+ * Like protobuf parsing, truncated replies and units or skills missing
+ * required fields are rejected, the table is then empty.
+ *
+ * Use it as the reply decoder of Basic::listUnits:
+ * \code
+ * auto table = std::make_shared<UnitTable>();
+ * auto [result, notifications] = basic.listUnits(client, table, in);
+ * \endcode
+ */
+class DFHACK_CLIENT_QT_EXPORT UnitTable: public Client::ReplyDecoder
+{
+public:
+	UnitTable();
+	~UnitTable() override;
+
+	bool decode(google::protobuf::io::CodedInputStream &input) override;
+	/**
+	 * Decode a serialized ListUnitsOut.
+	 */
+	bool parseFromString(const std::string &data);
+
+	/**
+	 * Remove all rows, keeping the capacity of the columns.
+	 */
+	void clear();
+
+	std::size_t size() const { return unit_id.size(); }
+
+	std::vector<std::int32_t> unit_id;
+	std::vector<std::int32_t> pos_x, pos_y, pos_z;
+	std::array<std::vector<std::uint32_t>, 3> flags; ///< flags1, flags2, flags3
+	std::vector<std::int32_t> race;
+	std::vector<std::int32_t> caste;
+	std::vector<std::int32_t> gender;
+	std::vector<std::int32_t> civ_id;
+	std::vector<std::int32_t> histfig_id;
+	std::vector<std::int32_t> squad_id;
+	std::vector<std::int32_t> squad_position;
+	std::vector<std::int32_t> profession;
+	/**
+	 * Labors of row i are labors[labor_offsets[i]] to
+	 * labors[labor_offsets[i+1]] (excluded).
+	 */
+	std::vector<std::uint32_t> labor_offsets;
+	std::vector<std::int32_t> labors;
+	/**
+	 * Skills of row i are at indices skill_offsets[i] to
+	 * skill_offsets[i+1] (excluded) of the skill columns.
+	 */
+	std::vector<std::uint32_t> skill_offsets;
+	std::vector<std::int32_t> skill_id, skill_level, skill_experience;
+
+	std::span<const std::int32_t> unitLabors(std::size_t row) const
+	{
+		return {labors.data() + labor_offsets[row], labors.data() + labor_offsets[row+1]};
+	}
+
+	/**
+	 * Row filter. All conditions must be met.
+	 */
+	struct Filter
+	{
+		/**
+		 * Bits that must be set in flags1, flags2, flags3.
+		 */
+		std::array<std::uint32_t, 3> flags_set = {};
+		/**
+		 * Bits that must be clear in flags1, flags2, flags3.
+		 */
+		std::array<std::uint32_t, 3> flags_clear = {};
+		std::optional<std::int32_t> race;
+		std::optional<std::int32_t> civ_id;
+	};
+
+	/**
+	 * Compute the rows matching \p filter as a bitmap: bit (i % 64) of
+	 * word (i / 64) is set if row i matches.
+	 */
+	void match(const Filter &filter, std::vector<std::uint64_t> &bitmap) const;
+	/**
+	 * Get the indices of rows matching \p filter.
+	 */
+	std::vector<std::uint32_t> select(const Filter &filter) const;
+
+private:
+	bool decodeUnits(google::protobuf::io::CodedInputStream &input);
+	bool decodeUnit(google::protobuf::io::CodedInputStream &input);
+	bool decodeSkill(google::protobuf::io::CodedInputStream &input);
+};
+
+} // namespace DFHack
+
+#endif
@@ -0,0 +1,58 @@
+/*
+ * Copyright 2023 Clement Vuchener
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef DFHACK_CLIENT_QT_TEST_UTILS_H
+#define DFHACK_CLIENT_QT_TEST_UTILS_H
+
+#include <QFuture>
+#include <QThread>
+
+#include <dfhack-client-qt/Client.h>
+
+namespace test
+{
+
+/**
+ * Client running in its own thread, as in test-sync.
+ */
+struct ClientThread
+{
+	DFHack::Client client;
+	QThread thread;
+
+	ClientThread() {
+		client.moveToThread(&thread);
+		thread.start();
+	}
+
+	~ClientThread() {
+		thread.quit();
+		thread.wait();
+	}
+};
+
+template <typename T>
+T sync(QFuture<T> &&future)
+{
+	future.waitForFinished();
+	return future.result();
+}
+
+} // namespace test
+
+#endif
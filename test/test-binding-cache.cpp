@@ -0,0 +1,85 @@
+/*
+ * Copyright 2023 Clement Vuchener
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <QCoreApplication>
+
+#include <dfhack-client-qt/Client.h>
+#include <dfhack-client-qt/Function.h>
+
+#include "MockServer.h"
+#include "TestUtils.h"
+
+#include <QtDebug>
+
+#include <optional>
+#include <vector>
+
+// More clients than Function binding cache slots
+static constexpr int ClientCount = 16;
+
+int main(int argc, char *argv[])
+{
+	QCoreApplication app(argc, argv);
+
+	MockServerThread server_thread;
+	auto port = server_thread.listen();
+	if (port == 0)
+		return -1;
+
+	const DFHack::Function<dfproto::EmptyMessage, dfproto::StringMessage> mock_payload = {"", "MockPayload"};
+	auto connect_client = [&](DFHack::Client &client) {
+		if (!test::sync(client.connect("localhost", port)))
+			qFatal("Failed to connect to mock server");
+		if (!test::sync(mock_payload.bind(client)))
+			qFatal("Failed to bind MockPayload");
+	};
+	// Every client gets its own binding, whatever slot it shares
+	auto check_bindings = [&](DFHack::Client &client) {
+		auto binding = mock_payload.binding(client);
+		if (binding != client.getBinding(mock_payload.bindRequest()))
+			qFatal("Function returned the binding of another client");
+		if (!test::sync(mock_payload(client).first))
+			qFatal("MockPayload call failed");
+	};
+
+	std::vector<std::optional<test::ClientThread>> clients(ClientCount);
+	for (auto &client_thread: clients) {
+		client_thread.emplace();
+		connect_client(client_thread->client);
+	}
+	for (int round = 0; round < 3; ++round)
+		for (auto &client_thread: clients)
+			check_bindings(client_thread->client);
+
+	// A new client at the address of a destroyed one does not reuse its
+	// cached binding.
+	for (auto &client_thread: clients) {
+		auto old_binding = mock_payload.binding(client_thread->client);
+		client_thread->client.disconnect().waitForFinished();
+		client_thread.reset();
+		client_thread.emplace();
+		connect_client(client_thread->client);
+		if (mock_payload.binding(client_thread->client) == old_binding)
+			qFatal("New client got the binding of a destroyed client");
+		check_bindings(client_thread->client);
+	}
+
+	for (auto &client_thread: clients)
+		client_thread->client.disconnect().waitForFinished();
+	return 0;
+}
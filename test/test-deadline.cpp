@@ -0,0 +1,80 @@
+/*
+ * Copyright 2023 Clement Vuchener
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <QCoreApplication>
+
+#include <dfhack-client-qt/Client.h>
+#include <dfhack-client-qt/Function.h>
+
+#include "MockServer.h"
+#include "TestUtils.h"
+
+#include <QtDebug>
+
+#include <vector>
+
+using namespace std::literals;
+
+static constexpr int QueuedCalls = 16;
+
+int main(int argc, char *argv[])
+{
+	QCoreApplication app(argc, argv);
+
+	MockServerThread server_thread;
+	auto &server = server_thread.server;
+	auto port = server_thread.listen();
+	if (port == 0)
+		return -1;
+
+	test::ClientThread client_thread;
+	DFHack::Client &client = client_thread.client;
+	if (!test::sync(client.connect("localhost", port)))
+		qFatal("Failed to connect to mock server");
+
+	using Reply = DFHack::CallReply<dfproto::StringMessage>;
+	const DFHack::Function<dfproto::EmptyMessage, dfproto::StringMessage> mock_payload = {"", "MockPayload"};
+	if (!test::sync(mock_payload.bind(client)))
+		qFatal("Failed to bind MockPayload");
+	server.setOptions({.processing_time = 50ms, .reply_size = 16});
+
+	// One call expires in flight and the others in the queue behind it.
+	// Their continuations run from the deadline check and retry without
+	// deadline, queuing new calls while it runs.
+	DFHack::CallOptions options;
+	options.deadline = QDeadlineTimer(10ms);
+	std::vector<QFuture<Reply>> retries;
+	for (int i = 0; i < 1 + QueuedCalls; ++i) {
+		retries.push_back(mock_payload(client, {}, options).first.then([&](Reply reply) {
+			if (reply.cr != DFHack::CommandResult::Timeout)
+				qFatal("Call did not time out");
+			return mock_payload(client).first;
+		}).unwrap());
+	}
+	for (auto &retry: retries) {
+		auto reply = test::sync(std::move(retry));
+		if (!reply || reply->value().size() != 16)
+			qFatal("Retried call failed");
+	}
+	// Bind, the call expired in flight and the retries
+	if (server.callCount() != 1 + 1 + 1 + QueuedCalls)
+		qFatal("Expired queued calls were sent");
+
+	client.disconnect().waitForFinished();
+	return 0;
+}
@@ -0,0 +1,96 @@
+/*
+ * Copyright 2023 Clement Vuchener
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <QCoreApplication>
+
+#include <dfhack-client-qt/LaborWriter.h>
+
+#include "MockServer.h"
+#include "TestUtils.h"
+
+#include <QMutex>
+#include <QtDebug>
+
+#include <map>
+#include <utility>
+
+using namespace std::literals;
+
+static constexpr int UnitId = 42;
+static constexpr int Labor = 3;
+
+int main(int argc, char *argv[])
+{
+	QCoreApplication app(argc, argv);
+
+	MockServerThread server_thread;
+	auto &server = server_thread.server;
+	QMutex labors_mutex;
+	std::map<std::pair<int, int>, bool> labors; // labors set on the server
+	std::atomic<int> calls = 0;
+	server.addMethod<dfproto::SetUnitLaborsIn, dfproto::EmptyMessage>("", "SetUnitLabors",
+		[&](const dfproto::SetUnitLaborsIn &in, dfproto::EmptyMessage &) {
+			QMutexLocker lock(&labors_mutex);
+			++calls;
+			for (const auto &change: in.change())
+				labors[{change.unit_id(), change.labor()}] = change.value();
+			return DFHack::CommandResult::Ok;
+		});
+	auto port = server_thread.listen();
+	if (port == 0)
+		return -1;
+
+	test::ClientThread client_thread;
+	DFHack::Client &client = client_thread.client;
+	if (!test::sync(client.connect("localhost", port)))
+		qFatal("Failed to connect to mock server");
+	server.setOptions({.processing_time = 50ms});
+
+	DFHack::LaborWriter writer(client);
+	writer.moveToThread(&client_thread.thread);
+	// The unit is known with all its labors disabled
+	dfproto::ListUnitsOut units;
+	units.add_value()->set_unit_id(UnitId);
+	writer.updateKnown(units);
+
+	// Toggle the labor on and off again while the first change is still
+	// being sent: the second change is not a no-op.
+	auto enable = writer.set(UnitId, Labor, true);
+	writer.flush();
+	auto disable = writer.set(UnitId, Labor, false);
+	writer.flush();
+	if (test::sync(std::move(enable)) != DFHack::CommandResult::Ok
+			|| test::sync(std::move(disable)) != DFHack::CommandResult::Ok)
+		qFatal("SetUnitLabors failed");
+	{
+		QMutexLocker lock(&labors_mutex);
+		if (calls != 2)
+			qFatal("Labor change in flight was not sent again");
+		if (labors[{UnitId, Labor}])
+			qFatal("Labor was left enabled");
+	}
+
+	// Once the writes are done, the same value is a no-op again
+	if (test::sync(writer.set(UnitId, Labor, false)) != DFHack::CommandResult::Ok)
+		qFatal("No-op change failed");
+	if (calls != 2)
+		qFatal("No-op change was sent");
+
+	client.disconnect().waitForFinished();
+	return 0;
+}